@@ -0,0 +1,85 @@
+#include "Commandlets/BakeLayoutsCommandlet.h"
+#include "Generator/Generator.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "UObject/Package.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBakeLayouts, Log, All);
+
+/** Parses a seed list such as "0-15,32,40-47". */
+static TArray<int32> ParseSeeds(const FString& SeedList)
+{
+	TArray<FString> Ranges;
+	SeedList.ParseIntoArray(Ranges, TEXT(","));
+
+	TArray<int32> Seeds;
+
+	for (const FString& Range : Ranges)
+	{
+		FString First, Last;
+
+		if (Range.Split(TEXT("-"), &First, &Last))
+		{
+			for (int32 Seed = FCString::Atoi(*First); Seed <= FCString::Atoi(*Last); Seed++)
+			{
+				Seeds.Add(Seed);
+			}
+		}
+		else
+		{
+			Seeds.Add(FCString::Atoi(*Range));
+		}
+	}
+
+	return Seeds;
+}
+
+UBakeLayoutsCommandlet::UBakeLayoutsCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UBakeLayoutsCommandlet::Main(const FString& Params)
+{
+	FString MapName;
+	FString SeedList = TEXT("0-63");
+
+	FParse::Value(*Params, TEXT("Map="), MapName);
+	FParse::Value(*Params, TEXT("Seeds="), SeedList);
+
+	const TArray<int32> Seeds = ParseSeeds(SeedList);
+
+	if (MapName.IsEmpty() || Seeds.IsEmpty())
+	{
+		UE_LOG(LogBakeLayouts, Error, TEXT("Nothing to bake: need a map and at least one seed."));
+		return 1;
+	}
+
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+
+	if (!World || !World->PersistentLevel)
+	{
+		UE_LOG(LogBakeLayouts, Error, TEXT("Could not load map %s."), *MapName);
+		return 1;
+	}
+
+	// Generators only need their settings and placement, so the world is never started.
+	int32 Generators = 0;
+	int32 Baked = 0;
+
+	for (AActor* Actor : World->PersistentLevel->Actors)
+	{
+		if (AGenerator* Generator = Cast<AGenerator>(Actor))
+		{
+			++Generators;
+			Baked += Generator->BakeLayoutCache(Seeds);
+		}
+	}
+
+	UE_LOG(LogBakeLayouts, Display, TEXT("Baked %d layouts for %d generators into %s."), Baked, Generators, *FDungeonLayoutCache::GetBakedDirectory());
+	return Generators > 0 ? 0 : 1;
+}
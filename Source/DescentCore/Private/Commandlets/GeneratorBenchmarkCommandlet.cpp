@@ -0,0 +1,292 @@
+#include "Commandlets/GeneratorBenchmarkCommandlet.h"
+#include "Generator/DungeonLayout.h"
+#include "Generator/SyntheticTileset.h"
+#include "Misc/FileHelper.h"
+#include <atomic>
+
+DEFINE_LOG_CATEGORY_STATIC(LogGeneratorBenchmark, Log, All);
+
+/**
+ * Allocator proxy that counts the allocations and reallocations made on the
+ * game thread while counting is on. It is installed as GMalloc once and never
+ * removed or destroyed, so threads that picked it up keep a valid allocator,
+ * and allocations made by other threads, including parallel batch solves,
+ * never reach the counts.
+ */
+class FCountingMalloc final : public FMalloc
+{
+public:
+
+	explicit FCountingMalloc(FMalloc* InInner)
+		: Inner(InInner)
+	{
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override
+	{
+		Inner->Free(Original);
+	}
+
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+	{
+		return Inner->QuantizeSize(Count, Alignment);
+	}
+
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+	{
+		return Inner->GetAllocationSize(Original, SizeOut);
+	}
+
+	virtual void Trim(bool bTrimThreadCaches) override
+	{
+		Inner->Trim(bTrimThreadCaches);
+	}
+
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		return Inner->IsInternallyThreadSafe();
+	}
+
+	virtual const TCHAR* GetDescriptiveName() override
+	{
+		return Inner->GetDescriptiveName();
+	}
+
+	/** Returns the proxy, installing it as GMalloc the first time. */
+	static FCountingMalloc& Get()
+	{
+		static FCountingMalloc* Instance = [] { FCountingMalloc* Proxy = new FCountingMalloc(GMalloc); GMalloc = Proxy; return Proxy; }();
+		return *Instance;
+	}
+
+	/** Whether game thread allocations are being counted. */
+	std::atomic<bool> bCounting { false };
+
+	/** Number of game thread allocations made while counting. */
+	std::atomic<int64> Allocations { 0 };
+
+private:
+
+	void CountAllocation()
+	{
+		if (bCounting.load(std::memory_order_relaxed) && IsInGameThread())
+		{
+			Allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	/** Allocator doing the actual work. */
+	FMalloc* Inner;
+};
+
+/** Aggregated results for a single golden path length. */
+struct FBenchmarkRow
+{
+	int32 Length = 0;
+	int32 Seeds = 0;
+	double P50Milliseconds = 0.0;
+	double P99Milliseconds = 0.0;
+	double MeanAllocations = 0.0;
+	double MeanRetries = 0.0;
+	double MeanBacktracks = 0.0;
+	double MeanTerminals = 0.0;
+	double MeanSealed = 0.0;
+	double FailedPathRate = 0.0;
+	double MeanLayoutBytes = 0.0;
+	double BatchLayoutsPerSecond = 0.0;
+};
+
+/** Returns the given percentile of an already sorted sample set. */
+static double GetPercentile(const TArray<double>& Sorted, double Percentile)
+{
+	const int32 Index = FMath::CeilToInt(Percentile * Sorted.Num()) - 1;
+	return Sorted[FMath::Clamp(Index, 0, Sorted.Num() - 1)];
+}
+
+UGeneratorBenchmarkCommandlet::UGeneratorBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UGeneratorBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 SeedCount = 1000;
+	FString LengthList = TEXT("8,32,128,500");
+	FString Format = TEXT("csv");
+	FString OutputPath;
+	int32 BacktrackSteps = FDungeonSolveParams().MaxBacktrackSteps;
+
+	FParse::Value(*Params, TEXT("Seeds="), SeedCount);
+	FParse::Value(*Params, TEXT("Lengths="), LengthList);
+	FParse::Value(*Params, TEXT("Format="), Format);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	FParse::Value(*Params, TEXT("BacktrackSteps="), BacktrackSteps);
+	const bool bBacktrack = FParse::Param(*Params, TEXT("Backtrack"));
+	const bool bParallel = FParse::Param(*Params, TEXT("Parallel"));
+
+	TArray<FString> LengthStrings;
+	LengthList.ParseIntoArray(LengthStrings, TEXT(","));
+
+	if (SeedCount <= 0 || LengthStrings.IsEmpty())
+	{
+		UE_LOG(LogGeneratorBenchmark, Error, TEXT("Nothing to run: need at least one seed and one length."));
+		return 1;
+	}
+
+	const FDungeonTileset Tileset = SyntheticTileset::Make();
+	TArray<FBenchmarkRow> Rows;
+
+	// Install the counting allocator before any solve, while nothing else runs.
+	FCountingMalloc& CountingMalloc = FCountingMalloc::Get();
+
+	for (const FString& LengthString : LengthStrings)
+	{
+		FDungeonSolveParams SolveParams;
+		SolveParams.GenerateLength = FCString::Atoi(*LengthString);
+		SolveParams.bBacktrack = bBacktrack;
+		SolveParams.MaxBacktrackSteps = BacktrackSteps;
+
+		if (SolveParams.GenerateLength <= 0)
+		{
+			continue;
+		}
+
+		// Warm up caches and allocator bins before measuring. The layout is
+		// reused for every seed, so the warm up also sizes its arrays and the
+		// counts below are those of a steady state solve.
+		FDungeonLayout Layout;
+		Layout.Solve(Tileset, SolveParams);
+
+		FBenchmarkRow Row;
+		Row.Length = SolveParams.GenerateLength;
+		Row.Seeds = SeedCount;
+
+		TArray<double> Times;
+		Times.Reserve(SeedCount);
+
+		int64 TotalAllocations = 0;
+		int64 TotalRetries = 0;
+		int64 TotalBacktracks = 0;
+		int64 TotalTerminals = 0;
+		int64 TotalSealed = 0;
+		int32 FailedPaths = 0;
+		int64 TotalLayoutBytes = 0;
+		TArray<uint8> LayoutData;
+
+		for (int32 SeedIndex = 0; SeedIndex < SeedCount; SeedIndex++)
+		{
+			SolveParams.Seed = SeedIndex;
+
+			// Count only the allocations made by the solve itself.
+			CountingMalloc.Allocations.store(0);
+			CountingMalloc.bCounting.store(true);
+
+			Layout.Solve(Tileset, SolveParams);
+
+			CountingMalloc.bCounting.store(false);
+
+			const FDungeonSolveStats& Stats = Layout.Stats;
+			Times.Add(Stats.SolveSeconds * 1000.0);
+			TotalAllocations += CountingMalloc.Allocations.load();
+			TotalRetries += Stats.DoorRetries;
+			TotalBacktracks += Stats.Backtracks;
+			TotalTerminals += Stats.TerminalCount;
+			TotalSealed += Stats.SealedCount;
+			FailedPaths += Stats.bReachedLength ? 0 : 1;
+
+			Layout.Save(Tileset, LayoutData);
+			TotalLayoutBytes += LayoutData.Num();
+		}
+
+		Times.Sort();
+		Row.P50Milliseconds = GetPercentile(Times, 0.50);
+		Row.P99Milliseconds = GetPercentile(Times, 0.99);
+		Row.MeanAllocations = (double)TotalAllocations / SeedCount;
+		Row.MeanRetries = (double)TotalRetries / SeedCount;
+		Row.MeanBacktracks = (double)TotalBacktracks / SeedCount;
+		Row.MeanTerminals = (double)TotalTerminals / SeedCount;
+		Row.MeanSealed = (double)TotalSealed / SeedCount;
+		Row.FailedPathRate = (double)FailedPaths / SeedCount;
+		Row.MeanLayoutBytes = (double)TotalLayoutBytes / SeedCount;
+
+		// Solve every seed again as one parallel batch to measure throughput.
+		if (bParallel)
+		{
+			TArray<FDungeonSolveParams> BatchParams;
+			BatchParams.Init(SolveParams, SeedCount);
+
+			for (int32 SeedIndex = 0; SeedIndex < SeedCount; SeedIndex++)
+			{
+				BatchParams[SeedIndex].Seed = SeedIndex;
+			}
+
+			TArray<FDungeonLayout> BatchLayouts;
+			const double BatchStart = FPlatformTime::Seconds();
+			FDungeonLayout::SolveBatch(Tileset, BatchParams, BatchLayouts);
+			Row.BatchLayoutsPerSecond = SeedCount / FMath::Max(FPlatformTime::Seconds() - BatchStart, UE_DOUBLE_SMALL_NUMBER);
+		}
+		Rows.Add(Row);
+	}
+
+	// Format the report.
+	FString Report;
+
+	if (Format.Equals(TEXT("json"), ESearchCase::IgnoreCase))
+	{
+		Report += TEXT("{\n\t\"results\": [\n");
+
+		for (int32 Index = 0; Index < Rows.Num(); Index++)
+		{
+			const FBenchmarkRow& Row = Rows[Index];
+			Report += FString::Printf(
+				TEXT("\t\t{ \"length\": %d, \"seeds\": %d, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"mean_allocations\": %.2f, \"mean_retries\": %.2f, \"mean_backtracks\": %.2f, \"mean_terminals\": %.2f, \"mean_sealed\": %.2f, \"failed_path_rate\": %.4f, \"mean_layout_bytes\": %.1f, \"batch_layouts_per_sec\": %.1f }%s\n"),
+				Row.Length, Row.Seeds, Row.P50Milliseconds, Row.P99Milliseconds, Row.MeanAllocations,
+				Row.MeanRetries, Row.MeanBacktracks, Row.MeanTerminals, Row.MeanSealed, Row.FailedPathRate, Row.MeanLayoutBytes,
+				Row.BatchLayoutsPerSecond,
+				Index + 1 < Rows.Num() ? TEXT(",") : TEXT("")
+			);
+		}
+
+		Report += TEXT("\t]\n}\n");
+	}
+	else
+	{
+		Report += TEXT("length,seeds,p50_ms,p99_ms,mean_allocations,mean_retries,mean_backtracks,mean_terminals,mean_sealed,failed_path_rate,mean_layout_bytes,batch_layouts_per_sec\n");
+
+		for (const FBenchmarkRow& Row : Rows)
+		{
+			Report += FString::Printf(
+				TEXT("%d,%d,%.4f,%.4f,%.2f,%.2f,%.2f,%.2f,%.2f,%.4f,%.1f,%.1f\n"),
+				Row.Length, Row.Seeds, Row.P50Milliseconds, Row.P99Milliseconds, Row.MeanAllocations,
+				Row.MeanRetries, Row.MeanBacktracks, Row.MeanTerminals, Row.MeanSealed, Row.FailedPathRate, Row.MeanLayoutBytes,
+				Row.BatchLayoutsPerSecond
+			);
+		}
+	}
+
+	UE_LOG(LogGeneratorBenchmark, Display, TEXT("mean_allocations counts game thread allocations during each sequential solve only."));
+	UE_LOG(LogGeneratorBenchmark, Display, TEXT("\n%s"), *Report);
+
+	if (!OutputPath.IsEmpty() && !FFileHelper::SaveStringToFile(Report, *OutputPath))
+	{
+		UE_LOG(LogGeneratorBenchmark, Error, TEXT("Could not write report to %s."), *OutputPath);
+		return 1;
+	}
+
+	return 0;
+}
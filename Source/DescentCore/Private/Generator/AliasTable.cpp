@@ -0,0 +1,78 @@
+#include "Generator/AliasTable.h"
+
+void FAliasTable::Build(TArrayView<const float> Weights)
+{
+	const int32 Count = Weights.Num();
+
+	Probability.SetNumUninitialized(Count);
+	Alias.SetNumUninitialized(Count);
+
+	if (Count == 0)
+	{
+		return;
+	}
+
+	// Sum the usable weights so they can be normalized.
+	double Total = 0.0;
+
+	for (float Weight : Weights)
+	{
+		Total += FMath::Max(Weight, 0.0f);
+	}
+
+	// Scale every weight so that the average column holds exactly one.
+	TArray<double, TInlineAllocator<32>> Scaled;
+	Scaled.SetNumUninitialized(Count);
+
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		Scaled[Index] = Total > 0.0 ? FMath::Max(Weights[Index], 0.0f) * Count / Total : 1.0;
+	}
+
+	// Split the columns into under- and over-full work lists.
+	TArray<int32, TInlineAllocator<32>> Small;
+	TArray<int32, TInlineAllocator<32>> Large;
+
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		(Scaled[Index] < 1.0 ? Small : Large).Add(Index);
+	}
+
+	// Fill each under-full column with the remainder of an over-full one.
+	while (!Small.IsEmpty() && !Large.IsEmpty())
+	{
+		const int32 Less = Small.Pop(false);
+		const int32 More = Large.Pop(false);
+
+		Probability[Less] = (float)Scaled[Less];
+		Alias[Less] = More;
+
+		Scaled[More] = (Scaled[More] + Scaled[Less]) - 1.0;
+		(Scaled[More] < 1.0 ? Small : Large).Add(More);
+	}
+
+	// Whatever is left is full up to rounding error.
+	for (int32 Index : Large)
+	{
+		Probability[Index] = 1.0f;
+		Alias[Index] = Index;
+	}
+
+	for (int32 Index : Small)
+	{
+		Probability[Index] = 1.0f;
+		Alias[Index] = Index;
+	}
+}
+
+int32 FAliasTable::Sample(FRandomStream& Stream) const
+{
+	if (Probability.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	// Pick a column, then either keep it or take its alias.
+	const int32 Column = Stream.RandHelper(Probability.Num());
+	return Stream.GetFraction() < Probability[Column] ? Column : Alias[Column];
+}
@@ -0,0 +1,1342 @@
+#include "Generator/DungeonLayout.h"
+#include "Generator/RoomDoorTable.h"
+#include "Algo/AnyOf.h"
+#include "Async/ParallelFor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogDungeonLayout, Log, All);
+
+/** Room index holding reserved cells in the grid while the golden path is built. */
+static constexpr int32 ReservedBranchRoom = -2;
+
+bool FDungeonTile::GetConnectionVectorsFor(const FTransform& RoomTransform, ERoomDoorFlags DoorType, FVector& OutPoint, FVector& OutDirection) const
+{
+	// Convert to door flags for ease of use.
+	ERoomDoorFlags RoomDoorFlags = (ERoomDoorFlags)DoorFlags;
+
+	// If there is no flag overlap, the door is impossible.
+	if ((RoomDoorFlags & DoorType) == ERoomDoorFlags::None)
+	{
+		return false;
+	}
+
+	// Look up the local direction and level of the door.
+	const int32 DoorIndex = RoomDoors::IndexOf((int32)DoorType);
+
+	if (DoorIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const FRoomDoorInfo& DoorInfo = RoomDoors::Table[DoorIndex];
+	const bool bAscent = DoorInfo.bAscent;
+	OutDirection = FVector(DoorInfo.DirectionX, DoorInfo.DirectionY, 0);
+
+	// Transform the direction from local to global coordinates.
+	OutDirection = RoomTransform.TransformVectorNoScale(OutDirection);
+
+	// Add half the room size in the out direction to the transform point
+	// to get the location of the given door (without height).
+	OutPoint = RoomTransform.GetLocation() + OutDirection * RoomSize * 50;
+
+	if (bAscent)
+	{
+		// Then add the full height if appropriate.
+		OutPoint += FVector::UpVector * RoomHeight * 100;
+	}
+
+	return true;
+}
+
+FTransform FDungeonTile::GetConnectionTransformFrom(const FVector& EntryPoint, const FVector& EntryDirection) const
+{
+	// Math only works if the direction vector is normal.
+	FVector UnitDirection = EntryDirection.GetSafeNormal();
+
+	// Determine the rotation from the unit direction.
+	FRotator RoomRotation = UnitDirection.Rotation();
+
+	// Determine the position by adding the direction plus the half the
+	// room size in centimeters (magic number is half a meter).
+	FVector RoomPosition = EntryPoint + UnitDirection * RoomSize * 50;
+
+	// Construct and return the new room transform.
+	return FTransform(RoomRotation, RoomPosition);
+}
+
+/** Sets the given cell, relative to the room's center, on the footprint of every quarter turn. */
+static void AddFootprintCell(uint64 (&Footprints)[4], int32 CellX, int32 CellY)
+{
+	// Turn the cell about the center, a quarter turn at a time.
+	for (int32 Yaw = 0; Yaw < 4; Yaw++)
+	{
+		Footprints[Yaw] |= 1ull << ((CellX + FRoomFootprint::Center) + 8 * (CellY + FRoomFootprint::Center));
+
+		const int32 TurnedX = -CellY;
+		CellY = CellX;
+		CellX = TurnedX;
+	}
+}
+
+void FDungeonTile::BuildFootprints()
+{
+	FootprintSize = FMath::Clamp(FootprintSize, 1, FRoomFootprint::MaxSize) | 1;
+	FootprintFloors = FMath::Max(FootprintFloors, 1);
+
+	const int32 Radius = GetFootprintRadius();
+
+	for (int32 Yaw = 0; Yaw < 4; Yaw++)
+	{
+		Footprints[Yaw] = 0;
+	}
+
+	for (int32 X = 0; X < FootprintSize; X++)
+	{
+		for (int32 Y = 0; Y < FootprintSize; Y++)
+		{
+			if (FootprintMask == 0 || (FootprintMask & (1ull << (X + FootprintSize * Y))) != 0)
+			{
+				AddFootprintCell(Footprints, X - Radius, Y - Radius);
+			}
+		}
+	}
+
+	// Rooms are entered through the middle of their southern edge and left
+	// through the middle of each door's edge. Keep those cells covered so
+	// that no other room can be placed over a doorway.
+	const FRoomDoorInfo& South = RoomDoors::Get((int32)ERoomDoorFlags::LowerDoorSouth);
+	AddFootprintCell(Footprints, South.DirectionX * Radius, South.DirectionY * Radius);
+
+	for (int32 Remaining = DoorFlags; Remaining != 0; Remaining &= Remaining - 1)
+	{
+		const FRoomDoorInfo& Door = RoomDoors::Get(Remaining & -Remaining);
+		AddFootprintCell(Footprints, Door.DirectionX * Radius, Door.DirectionY * Radius);
+	}
+
+	// The room's grid cell is its center, which must always be its own.
+	AddFootprintCell(Footprints, 0, 0);
+}
+
+void FDungeonTileset::Build()
+{
+	for (TArray<int32>& Bucket : Buckets)
+	{
+		Bucket.Reset();
+	}
+
+	MaxDoorCount = 0;
+
+	// Distribute the tiles by type.
+	for (int32 TileIndex = 0; TileIndex < Tiles.Num(); TileIndex++)
+	{
+		Tiles[TileIndex].BuildFootprints();
+		Buckets[(int32)Tiles[TileIndex].RoomType].Add(TileIndex);
+		MaxDoorCount = FMath::Max(MaxDoorCount, static_cast<int32>(FMath::CountBits((uint32)Tiles[TileIndex].DoorFlags)));
+	}
+
+	// Build each bucket's sampler from its tile weights.
+	for (int32 Type = 0; Type <= (int32)ERoomType::Boss; Type++)
+	{
+		TArray<float, TInlineAllocator<32>> Weights;
+		Weights.Reserve(Buckets[Type].Num());
+
+		for (int32 TileIndex : Buckets[Type])
+		{
+			Weights.Add(Tiles[TileIndex].Weight);
+		}
+
+		Samplers[Type].Build(Weights);
+	}
+}
+
+int32 FDungeonTileset::GetRandomTile(ERoomType RoomType, FRandomStream& Stream) const
+{
+	const TArray<int32>& Bucket = Buckets[(int32)RoomType];
+	const int32 Index = Samplers[(int32)RoomType].Sample(Stream);
+
+	// Only fails if the tileset has no tile of this type.
+	return Bucket.IsValidIndex(Index) ? Bucket[Index] : INDEX_NONE;
+}
+
+uint32 FDungeonTileset::GetContentHash() const
+{
+	uint32 Hash = GetTypeHash(Tiles.Num());
+
+	for (const FDungeonTile& Tile : Tiles)
+	{
+		Hash = HashCombine(Hash, GetTypeHash((uint8)Tile.RoomType));
+		Hash = HashCombine(Hash, GetTypeHash(Tile.DoorFlags));
+		Hash = HashCombine(Hash, GetTypeHash(Tile.Weight));
+		Hash = HashCombine(Hash, GetTypeHash(Tile.RoomSize));
+		Hash = HashCombine(Hash, GetTypeHash(Tile.RoomHeight));
+		Hash = HashCombine(Hash, GetTypeHash(Tile.FootprintSize));
+		Hash = HashCombine(Hash, GetTypeHash(Tile.FootprintMask));
+		Hash = HashCombine(Hash, GetTypeHash(Tile.FootprintFloors));
+	}
+
+	return Hash;
+}
+
+uint32 FDungeonConstraints::GetHash() const
+{
+	if (IsEmpty())
+	{
+		return 0;
+	}
+
+	uint32 Hash = HashCombine(GetTypeHash(TreasureCount), GetTypeHash(MinBranches));
+	Hash = HashCombine(Hash, GetTypeHash(MaxAttempts));
+
+	for (int32 PathIndex : LockedPathIndices)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(PathIndex));
+	}
+
+	return Hash;
+}
+
+/**
+ * Places the doorway behind one of a room's doors: the first cell past the
+ * room's edge, the door's position and the direction it faces. Pass the
+ * result to EnterTile to place a room there. Everything stays in whole
+ * cells, centimeters and quarter turns, so placements compare exactly.
+ *
+ * @param Tile Tile of the room being left.
+ * @param Room Room being left.
+ * @param DoorFlag Door to leave through, in the room's own rotation.
+ */
+static FDungeonRoom StepThroughDoor(const FDungeonTile& Tile, const FDungeonRoom& Room, int32 DoorFlag)
+{
+	const FRoomDoorInfo& Door = RoomDoors::Get(RoomDoors::Rotate(DoorFlag, Room.Yaw));
+	const FIntVector Direction(Door.DirectionX, Door.DirectionY, 0);
+
+	// Doors sit half a room out from the center (magic number is half a meter).
+	FDungeonRoom Doorway;
+	Doorway.GridCell = Room.GridCell + Direction * (Tile.GetFootprintRadius() + 1);
+	Doorway.Offset = Room.Offset + Direction * (Tile.RoomSize * 50);
+	Doorway.Yaw = (uint8)Door.Yaw;
+
+	// Upper doors lead onto the floor above the room's topmost one.
+	if (Door.bAscent)
+	{
+		Doorway.GridCell.Z += Tile.FootprintFloors;
+		Doorway.Offset.Z += Tile.RoomHeight * 100;
+	}
+
+	return Doorway;
+}
+
+/** Moves a doorway from StepThroughDoor to the center of the given tile entered through it. */
+static void EnterTile(const FDungeonTile& Tile, FDungeonRoom& Doorway)
+{
+	const FRoomDoorInfo& Forward = RoomDoors::Get(RoomDoors::Rotate((int32)ERoomDoorFlags::LowerDoorNorth, Doorway.Yaw));
+	const FIntVector Direction(Forward.DirectionX, Forward.DirectionY, 0);
+
+	Doorway.GridCell += Direction * Tile.GetFootprintRadius();
+	Doorway.Offset += Direction * (Tile.RoomSize * 50);
+}
+
+/** Returns the rotation of the given number of quarter turns about the up axis. */
+static FQuat GetYawRotation(int32 Yaw)
+{
+	return FRotator(0, Yaw * 90, 0).Quaternion();
+}
+
+void FDungeonLayout::Reset(int32 ExpectedRooms)
+{
+	Rooms.Reset(ExpectedRooms);
+	Doors.Reset(ExpectedRooms);
+	Cells.Reset(ExpectedRooms);
+	Stats = FDungeonSolveStats();
+	SpawnSeed = 0;
+	Origin = FTransform::Identity;
+}
+
+FTransform FDungeonLayout::GetRoomTransform(int32 RoomIndex) const
+{
+	const FDungeonRoom& Room = Rooms[RoomIndex];
+	const FQuat Rotation = Origin.GetRotation() * GetYawRotation(Room.Yaw);
+	const FVector Location = Origin.TransformPositionNoScale(FVector(Room.Offset));
+
+	// Only the start room takes on the origin's scale.
+	return FTransform(Rotation, Location, RoomIndex == 0 ? Origin.GetScale3D() : FVector::OneVector);
+}
+
+FTransform FDungeonLayout::GetDoorTransform(const FDungeonTileset& Tileset, int32 DoorIndex) const
+{
+	const FDungeonDoor& Door = Doors[DoorIndex];
+	const FDungeonRoom& Room = Rooms[Door.OwnerRoom];
+	const FDungeonTile& Tile = Tileset.Tiles[Room.TileIndex];
+	const FRoomDoorInfo& Info = RoomDoors::Get(RoomDoors::Rotate(Door.DoorFlag, Room.Yaw));
+
+	// Doors sit half a room out from the center (magic number is half a
+	// meter), and a full room height up if they are upper doors.
+	FVector Location = FVector(Room.Offset) + FVector(Info.DirectionX, Info.DirectionY, 0) * Tile.RoomSize * 50;
+
+	if (Info.bAscent)
+	{
+		Location.Z += Tile.RoomHeight * 100;
+	}
+
+	return FTransform(Origin.GetRotation() * GetYawRotation(Info.Yaw), Origin.TransformPositionNoScale(Location));
+}
+
+bool FDungeonLayout::Solve(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const FDungeonConstraints& Constraints = Params.Constraints;
+	const int32 MaxAttempts = Constraints.IsEmpty() ? 1 : FMath::Max(Constraints.MaxAttempts, 1);
+
+	// Bad locks can never be met, so they are dropped here rather than retried.
+	FLockArray Locks;
+	GatherLocks(Params, Locks);
+
+	// Constraints are enforced while rooms are placed, but a golden path can
+	// still leave too little room for them. Try derived seeds a bounded
+	// number of times, remembering the attempt that came closest.
+	int32 Attempts = 0;
+	int32 AttemptSeed = Params.Seed;
+	int32 BestSeed = Params.Seed;
+	int32 BestSatisfied = -1;
+	bool bSolved = false;
+
+	while (Attempts < MaxAttempts)
+	{
+		AttemptSeed = Attempts == 0 ? Params.Seed : (int32)HashCombine(GetTypeHash(Params.Seed), GetTypeHash(Attempts));
+		++Attempts;
+
+		// Without a start room no seed will do.
+		bSolved = SolveAttempt(Tileset, Params, Locks, AttemptSeed);
+
+		if (!bSolved)
+		{
+			break;
+		}
+
+		const int32 Satisfied = Stats.GetSatisfiedCount();
+
+		if (Satisfied > BestSatisfied)
+		{
+			BestSatisfied = Satisfied;
+			BestSeed = AttemptSeed;
+		}
+
+		if (Satisfied == 3)
+		{
+			break;
+		}
+	}
+
+	// The last attempt isn't always the closest one.
+	if (bSolved && BestSeed != AttemptSeed)
+	{
+		SolveAttempt(Tileset, Params, Locks, BestSeed);
+	}
+
+	Stats.Attempts = Attempts;
+	Stats.SolveSeconds = FPlatformTime::Seconds() - StartTime;
+	return bSolved;
+}
+
+void FDungeonLayout::GatherLocks(const FDungeonSolveParams& Params, FLockArray& OutLocks)
+{
+	const TArray<int32>& LockedPathIndices = Params.Constraints.LockedPathIndices;
+
+	for (int32 LockIndex = 0; LockIndex < LockedPathIndices.Num(); LockIndex++)
+	{
+		const int32 PathIndex = LockedPathIndices[LockIndex];
+
+		// Only golden path rooms with an exit can be locked.
+		if (PathIndex < 0 || PathIndex >= Params.GenerateLength - 1)
+		{
+			UE_LOG(LogDungeonLayout, Error, TEXT("Ignoring lock %d: path index %d has no exit on a golden path of length %d."), LockIndex, PathIndex, Params.GenerateLength);
+			continue;
+		}
+
+		if (Algo::AnyOf(OutLocks, [PathIndex](const FLockRequest& Lock) { return Lock.PathIndex == PathIndex; }))
+		{
+			UE_LOG(LogDungeonLayout, Error, TEXT("Ignoring lock %d: path index %d is already locked."), LockIndex, PathIndex);
+			continue;
+		}
+
+		OutLocks.Add({ PathIndex, LockIndex });
+	}
+
+	// Keys are placed in path order, each past the previous lock.
+	OutLocks.Sort([](const FLockRequest& A, const FLockRequest& B)
+	{
+		return A.PathIndex < B.PathIndex;
+	});
+}
+
+bool FDungeonLayout::SolveAttempt(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params, const FLockArray& Locks, int32 AttemptSeed)
+{
+	// Every selection below draws from this stream so that a seed always reproduces its level.
+	FRandomStream Stream(AttemptSeed);
+
+	// Each golden path room leads to at most one room per door besides its
+	// entrance, so this bounds both rooms and doors. A layout that is reused
+	// keeps its capacity and solves without growing.
+	Reset(Params.GenerateLength * FMath::Max(Tileset.GetMaxDoorCount(), 1));
+	Origin = Params.Origin;
+
+	// Scratch state goes on this thread's memory stack and is freed in one
+	// go when the mark goes out of scope, so it never reaches the heap.
+	FMemMark Mark(FMemStack::Get());
+
+	// Doors of each golden path room left over for the backfill pass.
+	FDoorMaskArray GoldenEmptyDoors;
+	GoldenEmptyDoors.Reserve(Params.GenerateLength);
+
+	// Cells held for branches while the golden path is built.
+	FBranchArray Branches;
+	Branches.Reserve(Params.Constraints.MinBranches);
+
+	// No start room? Exit.
+	const int32 StartTile = Tileset.GetRandomTile(ERoomType::Start, Stream);
+
+	if (StartTile == INDEX_NONE)
+	{
+		return false;
+	}
+
+	if (Params.bBacktrack)
+	{
+		SolveBacktrackingPath(Tileset, Params, StartTile, Stream, GoldenEmptyDoors, Branches);
+	}
+	else
+	{
+		SolveGreedyPath(Tileset, Params, StartTile, Stream, GoldenEmptyDoors, Branches);
+	}
+
+	Stats.GoldenLength = GoldenEmptyDoors.Num();
+	Stats.bReachedLength = Stats.GoldenLength == Params.GenerateLength;
+
+	// Hand the held cells back before any terminal is placed, but keep the
+	// reservations so that their terminals go in before the backfill.
+	FreeBranchCells(Branches, 0);
+
+	// Keys go first so that the other terminals can't take their spots. Keys
+	// are branches too, so they may take a reserved spot before its branch.
+	PlaceKeys(Tileset, Locks, Stream, GoldenEmptyDoors);
+	PlaceBranches(Tileset, Stream, Branches, GoldenEmptyDoors);
+	BackfillPath(Tileset, Stream, GoldenEmptyDoors);
+	PlaceTreasure(Params.Constraints, Stream);
+	Stats.bBranchesSatisfied = Stats.TerminalCount >= Params.Constraints.MinBranches;
+
+	// Seed each room's spawns last so they don't disturb the layout draws.
+	// A single draw keeps saved layouts from having to store every seed.
+	SpawnSeed = Stream.GetUnsignedInt();
+
+	for (int32 RoomIndex = 0; RoomIndex < Rooms.Num(); RoomIndex++)
+	{
+		Rooms[RoomIndex].SpawnSeed = (int32)HashCombine(SpawnSeed, GetTypeHash(RoomIndex));
+	}
+
+	return true;
+}
+
+void FDungeonLayout::SolveBatch(const FDungeonTileset& Tileset, TConstArrayView<FDungeonSolveParams> Params, TArray<FDungeonLayout>& OutLayouts)
+{
+	// Size the output up front so that workers never touch the array itself.
+	OutLayouts.SetNum(Params.Num());
+
+	ParallelFor(Params.Num(), [&Tileset, &Params, &OutLayouts](int32 Index)
+	{
+		OutLayouts[Index].Solve(Tileset, Params[Index]);
+	});
+}
+
+int32 FDungeonLayout::AddGoldenRoom(const FDungeonTileset& Tileset, int32 TileIndex, const FDungeonRoom& Placement, int32 EntranceDoor)
+{
+	const int32 RoomIndex = Rooms.Num();
+
+	FDungeonRoom& NewRoom = Rooms.Add_GetRef(Placement);
+	NewRoom.TileIndex = TileIndex;
+	NewRoom.PathIndex = RoomIndex;
+	Cells.TryOccupy(NewRoom.GridCell, Tileset.Tiles[TileIndex].GetFootprint(NewRoom.Yaw), RoomIndex);
+
+	// Hook up the door we came in through.
+	if (EntranceDoor != INDEX_NONE)
+	{
+		Doors[EntranceDoor].EntranceOf = RoomIndex;
+		Doors[EntranceDoor].LeadsTo = RoomIndex;
+	}
+
+	return RoomIndex;
+}
+
+void FDungeonLayout::SolveGreedyPath(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params, int32 StartTile, FRandomStream& Stream, FDoorMaskArray& OutEmptyDoors, FBranchArray& OutBranches)
+{
+	const int32 GenerateLength = Params.GenerateLength;
+
+	// Variables used in the generator loop. The start room sits at the origin.
+	FDungeonRoom Placement;
+	int32 RoomSelection = StartTile;
+	int32 EntranceDoor = INDEX_NONE;
+	int32 RoomsRemaining = GenerateLength;
+
+	// We always enter through the "southern" door, so exclude it.
+	const int32 South = (int32)ERoomDoorFlags::LowerDoorSouth;
+
+	// Generate the golden path.
+	while (RoomSelection != INDEX_NONE && RoomsRemaining > 0)
+	{
+		const FDungeonTile& RoomTile = Tileset.Tiles[RoomSelection];
+
+		// Store room data for collision and backfill.
+		const int32 RoomIndex = AddGoldenRoom(Tileset, RoomSelection, Placement, EntranceDoor);
+		int32 EmptyDoors = RoomTile.DoorFlags & ~South;
+
+		// With the new room in place, the previous room's spare doors are final.
+		if (RoomIndex > 0)
+		{
+			ReserveBranches(Tileset, Params, Stream, RoomIndex - 1, OutEmptyDoors[RoomIndex - 1], OutBranches);
+		}
+
+		// Decrement. The last room of the path needs no exit.
+		if (--RoomsRemaining == 0)
+		{
+			OutEmptyDoors.Add(EmptyDoors);
+			break;
+		}
+
+		// Used to track doors.
+		FDungeonRoom NextPlacement;
+		int32 CurrentDoor = 0;
+		int32 CandidateDoors = EmptyDoors;
+
+		// Randomly pick doors until the room behind one fits.
+		// Rejected doors are confirmed to overlap.
+		while (CandidateDoors != 0)
+		{
+			CurrentDoor = RoomDoors::SelectRandom(CandidateDoors, Stream);
+
+			// Find the cell behind the door for collision checks.
+			NextPlacement = StepThroughDoor(RoomTile, Placement, CurrentDoor);
+
+			// Check the occupancy grid for an overlapping room.
+			if (!Cells.IsOccupied(NextPlacement.GridCell))
+			{
+				// Pick a new connector room. If this is the last room, then select a boss room.
+				// If we can't build the golden path any further (no rooms available) then the loop caps it off.
+				RoomSelection = Tileset.GetRandomTile(RoomsRemaining > 1 ? ERoomType::Connector : ERoomType::Boss, Stream);
+
+				if (RoomSelection == INDEX_NONE)
+				{
+					break;
+				}
+
+				// Larger rooms need the rest of their footprint free too.
+				const FDungeonTile& NextTile = Tileset.Tiles[RoomSelection];
+				EnterTile(NextTile, NextPlacement);
+
+				if (!Cells.Overlaps(NextPlacement.GridCell, NextTile.GetFootprint(NextPlacement.Yaw)))
+				{
+					break;
+				}
+			}
+
+			CandidateDoors &= ~CurrentDoor; // Don't try this door again.
+			++Stats.DoorRetries;
+		}
+
+		// If every door collides, then the path can't go any further, so cap it off here.
+		if (CandidateDoors == 0)
+		{
+			OutEmptyDoors.Add(EmptyDoors);
+			break;
+		}
+
+		// Exclude the door we exit through.
+		OutEmptyDoors.Add(EmptyDoors & ~CurrentDoor);
+
+		// Register the exit door; the next room uses it as its entrance.
+		FDungeonDoor ExitDoor;
+		ExitDoor.OwnerRoom = RoomIndex;
+		ExitDoor.DoorFlag = CurrentDoor;
+		ExitDoor.ExitOf = RoomIndex;
+		EntranceDoor = Doors.Emplace(ExitDoor);
+
+		// Move on to the next room position.
+		Placement = NextPlacement;
+	}
+}
+
+void FDungeonLayout::SolveBacktrackingPath(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params, int32 StartTile, FRandomStream& Stream, FDoorMaskArray& OutEmptyDoors, FBranchArray& OutBranches)
+{
+	const int32 GenerateLength = Params.GenerateLength;
+
+	// We always enter through the "southern" door, so exclude it.
+	const int32 South = (int32)ERoomDoorFlags::LowerDoorSouth;
+
+	// Doors of each path room that have not been tried yet, and the door each room exits through.
+	FDoorMaskArray CandidateDoors;
+	FDoorMaskArray ExitDoors;
+	CandidateDoors.Reserve(GenerateLength);
+	ExitDoors.Reserve(GenerateLength);
+
+	if (GenerateLength <= 0)
+	{
+		return;
+	}
+
+	AddGoldenRoom(Tileset, StartTile, FDungeonRoom(), INDEX_NONE);
+	CandidateDoors.Add(Tileset.Tiles[StartTile].DoorFlags & ~South);
+	ExitDoors.Add(0);
+
+	// Depth-first search: extend the path through an untried door, or
+	// undo the newest room once all of its doors are exhausted.
+	for (int32 Step = 0; Rooms.Num() < GenerateLength; Step++)
+	{
+		// Stop at the budget and keep whatever path we have.
+		if (Step >= Params.MaxBacktrackSteps)
+		{
+			break;
+		}
+
+		const int32 Top = Rooms.Num() - 1;
+
+		if (CandidateDoors[Top] == 0)
+		{
+			// The start room has nowhere left to go; no path exists.
+			if (Top == 0)
+			{
+				break;
+			}
+
+			// Dead end, so remove the room, the door leading into it and the
+			// branches held when the previous room was left.
+			int32 FirstBranch = OutBranches.Num();
+
+			while (FirstBranch > 0 && OutBranches[FirstBranch - 1].RoomIndex >= Top - 1)
+			{
+				--FirstBranch;
+			}
+
+			ReleaseBranches(OutBranches, FirstBranch);
+			Cells.Release(Rooms[Top].GridCell, Tileset.Tiles[Rooms[Top].TileIndex].GetFootprint(Rooms[Top].Yaw));
+			Rooms.Pop(false);
+			Doors.Pop(false);
+			CandidateDoors.Pop(false);
+			ExitDoors.Pop(false);
+			ExitDoors[Top - 1] = 0;
+			++Stats.Backtracks;
+			continue;
+		}
+
+		// Take an untried door out of the newest room.
+		const FDungeonTile& RoomTile = Tileset.Tiles[Rooms[Top].TileIndex];
+		const int32 CurrentDoor = RoomDoors::SelectRandom(CandidateDoors[Top], Stream);
+		CandidateDoors[Top] &= ~CurrentDoor;
+
+		FDungeonRoom NextPlacement = StepThroughDoor(RoomTile, Rooms[Top], CurrentDoor);
+
+		// Never place overlapping rooms.
+		if (Cells.IsOccupied(NextPlacement.GridCell))
+		{
+			++Stats.DoorRetries;
+			continue;
+		}
+
+		// Pick a new connector room. If this is the last room, then select a boss room.
+		const bool bLastRoom = Rooms.Num() == GenerateLength - 1;
+		const int32 NextTile = Tileset.GetRandomTile(bLastRoom ? ERoomType::Boss : ERoomType::Connector, Stream);
+
+		// The tileset can't build the path any further.
+		if (NextTile == INDEX_NONE)
+		{
+			break;
+		}
+
+		// Larger rooms need the rest of their footprint free too.
+		EnterTile(Tileset.Tiles[NextTile], NextPlacement);
+
+		if (Cells.Overlaps(NextPlacement.GridCell, Tileset.Tiles[NextTile].GetFootprint(NextPlacement.Yaw)))
+		{
+			++Stats.DoorRetries;
+			continue;
+		}
+
+		// Register the exit door, then the room it leads into.
+		FDungeonDoor ExitDoor;
+		ExitDoor.OwnerRoom = Top;
+		ExitDoor.DoorFlag = CurrentDoor;
+		ExitDoor.ExitOf = Top;
+		ExitDoors[Top] = CurrentDoor;
+		const int32 EntranceDoor = Doors.Emplace(ExitDoor);
+
+		AddGoldenRoom(Tileset, NextTile, NextPlacement, EntranceDoor);
+		CandidateDoors.Add(Tileset.Tiles[NextTile].DoorFlags & ~South);
+		ExitDoors.Add(0);
+
+		// Hold space for branches off the room just left; undone if it is backtracked into.
+		ReserveBranches(Tileset, Params, Stream, Top, RoomTile.DoorFlags & ~South & ~CurrentDoor, OutBranches);
+	}
+
+	// Every door not used by the path is left for the backfill pass.
+	for (int32 RoomIndex = 0; RoomIndex < Rooms.Num(); RoomIndex++)
+	{
+		OutEmptyDoors.Add(Tileset.Tiles[Rooms[RoomIndex].TileIndex].DoorFlags & ~South & ~ExitDoors[RoomIndex]);
+	}
+}
+
+int32 FDungeonLayout::TryPlaceTerminal(const FDungeonTileset& Tileset, FRandomStream& Stream, int32 RoomIndex, int32 DoorFlag, int32 TerminalTile)
+{
+	// Find the cell behind the door for collision checks. Copy what we
+	// need from the room, since the array grows as terminals are added.
+	const FDungeonRoom& Room = Rooms[RoomIndex];
+	FDungeonRoom Terminal = StepThroughDoor(Tileset.Tiles[Room.TileIndex], Room, DoorFlag);
+	Terminal.PathIndex = Room.PathIndex;
+
+	// We can only put a room here if the cell is free and a terminal exists.
+	if (Cells.IsOccupied(Terminal.GridCell))
+	{
+		return INDEX_NONE;
+	}
+
+	if (TerminalTile == INDEX_NONE)
+	{
+		TerminalTile = Tileset.GetRandomTile(ERoomType::Terminal, Stream);
+
+		if (TerminalTile == INDEX_NONE)
+		{
+			return INDEX_NONE;
+		}
+	}
+
+	// Larger terminals need the rest of their footprint free too.
+	const FDungeonTile& Tile = Tileset.Tiles[TerminalTile];
+	EnterTile(Tile, Terminal);
+
+	const FRoomFootprint Footprint = Tile.GetFootprint(Terminal.Yaw);
+
+	if (Cells.Overlaps(Terminal.GridCell, Footprint))
+	{
+		return INDEX_NONE;
+	}
+
+	// Register an exit door with the current room.
+	const int32 TerminalIndex = Rooms.Num();
+
+	FDungeonDoor Door;
+	Door.OwnerRoom = RoomIndex;
+	Door.DoorFlag = DoorFlag;
+	Door.ExitOf = RoomIndex;
+	Door.LeadsTo = TerminalIndex;
+	Doors.Emplace(Door);
+
+	// We need to register the new terminal for collision.
+	Terminal.TileIndex = TerminalTile;
+	Cells.TryOccupy(Terminal.GridCell, Footprint, TerminalIndex);
+	Rooms.Emplace(Terminal);
+	++Stats.TerminalCount;
+
+	return TerminalIndex;
+}
+
+void FDungeonLayout::ReserveBranches(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params, FRandomStream& Stream, int32 RoomIndex, int32 SpareDoors, FBranchArray& Branches)
+{
+	const int32 Needed = Params.Constraints.MinBranches - Branches.Num();
+
+	if (Needed <= 0)
+	{
+		return;
+	}
+
+	// Spread the branches over the rooms still to be left, rather than
+	// crowding them around the start of the path.
+	const int32 RoomsLeft = FMath::Max(Params.GenerateLength - 1 - RoomIndex, 1);
+	int32 Count = FMath::DivideAndRoundUp(Needed, RoomsLeft);
+
+	const FDungeonRoom& Room = Rooms[RoomIndex];
+	const FDungeonTile& RoomTile = Tileset.Tiles[Room.TileIndex];
+
+	while (Count > 0 && SpareDoors != 0)
+	{
+		const int32 CurrentDoor = RoomDoors::SelectRandom(SpareDoors, Stream);
+		SpareDoors &= ~CurrentDoor;
+
+		FDungeonRoom Branch = StepThroughDoor(RoomTile, Room, CurrentDoor);
+
+		if (Cells.IsOccupied(Branch.GridCell))
+		{
+			continue;
+		}
+
+		const int32 TerminalTile = Tileset.GetRandomTile(ERoomType::Terminal, Stream);
+
+		// Without terminals there is nothing to hold space for.
+		if (TerminalTile == INDEX_NONE)
+		{
+			return;
+		}
+
+		const FDungeonTile& Tile = Tileset.Tiles[TerminalTile];
+		EnterTile(Tile, Branch);
+
+		FBranchReservation Reservation;
+		Reservation.RoomIndex = RoomIndex;
+		Reservation.DoorFlag = CurrentDoor;
+		Reservation.TileIndex = TerminalTile;
+		Reservation.Center = Branch.GridCell;
+		Reservation.Footprint = Tile.GetFootprint(Branch.Yaw);
+
+		if (Cells.TryOccupy(Reservation.Center, Reservation.Footprint, ReservedBranchRoom))
+		{
+			Branches.Add(Reservation);
+			--Count;
+		}
+	}
+}
+
+void FDungeonLayout::FreeBranchCells(const FBranchArray& Branches, int32 FirstBranch)
+{
+	for (int32 BranchIndex = FirstBranch; BranchIndex < Branches.Num(); BranchIndex++)
+	{
+		Cells.Release(Branches[BranchIndex].Center, Branches[BranchIndex].Footprint);
+	}
+}
+
+void FDungeonLayout::ReleaseBranches(FBranchArray& Branches, int32 FirstBranch)
+{
+	FreeBranchCells(Branches, FirstBranch);
+	Branches.SetNum(FirstBranch, false);
+}
+
+void FDungeonLayout::PlaceBranches(const FDungeonTileset& Tileset, FRandomStream& Stream, const FBranchArray& Branches, FDoorMaskArray& GoldenEmptyDoors)
+{
+	for (const FBranchReservation& Branch : Branches)
+	{
+		// A key may have taken the door already.
+		if ((GoldenEmptyDoors[Branch.RoomIndex] & Branch.DoorFlag) == 0)
+		{
+			continue;
+		}
+
+		if (TryPlaceTerminal(Tileset, Stream, Branch.RoomIndex, Branch.DoorFlag, Branch.TileIndex) != INDEX_NONE)
+		{
+			GoldenEmptyDoors[Branch.RoomIndex] &= ~Branch.DoorFlag;
+		}
+	}
+}
+
+void FDungeonLayout::PlaceKeys(const FDungeonTileset& Tileset, const FLockArray& Locks, FRandomStream& Stream, FDoorMaskArray& GoldenEmptyDoors)
+{
+	const int32 GoldenLength = GoldenEmptyDoors.Num();
+
+	// Golden path rooms a key can branch off, and their spare doors not tried yet.
+	TArray<int32, TMemStackAllocator<>> WindowRooms;
+	FDoorMaskArray WindowDoors;
+
+	// Each key must be reachable past the previous lock but before its own.
+	int32 WindowStart = 0;
+
+	for (const FLockRequest& Lock : Locks)
+	{
+		const int32 LockedRoom = Lock.PathIndex;
+		const int32 LockIndex = Lock.LockIndex;
+
+		// A golden path cut short may not reach the locked room's exit.
+		if (LockedRoom >= GoldenLength - 1)
+		{
+			continue;
+		}
+
+		WindowRooms.Reset();
+		WindowDoors.Reset();
+
+		for (int32 RoomIndex = WindowStart; RoomIndex <= LockedRoom; RoomIndex++)
+		{
+			if (GoldenEmptyDoors[RoomIndex] != 0)
+			{
+				WindowRooms.Add(RoomIndex);
+				WindowDoors.Add(GoldenEmptyDoors[RoomIndex]);
+			}
+		}
+
+		WindowStart = LockedRoom + 1;
+
+		// Try random spare doors of the window until a terminal fits behind one.
+		int32 KeyRoom = INDEX_NONE;
+
+		while (KeyRoom == INDEX_NONE && !WindowRooms.IsEmpty())
+		{
+			const int32 Pick = Stream.RandHelper(WindowRooms.Num());
+			const int32 RoomIndex = WindowRooms[Pick];
+			const int32 CurrentDoor = RoomDoors::SelectRandom(WindowDoors[Pick], Stream);
+			WindowDoors[Pick] &= ~CurrentDoor;
+
+			KeyRoom = TryPlaceTerminal(Tileset, Stream, RoomIndex, CurrentDoor);
+
+			if (KeyRoom != INDEX_NONE)
+			{
+				// The backfill pass must not reuse the door.
+				GoldenEmptyDoors[RoomIndex] &= ~CurrentDoor;
+			}
+			else if (WindowDoors[Pick] == 0)
+			{
+				WindowRooms.RemoveAtSwap(Pick, 1, false);
+				WindowDoors.RemoveAtSwap(Pick, 1, false);
+			}
+		}
+
+		// Never lock a door without a key to open it.
+		if (KeyRoom == INDEX_NONE)
+		{
+			continue;
+		}
+
+		Rooms[KeyRoom].Role = ERoomRole::Key;
+		Rooms[KeyRoom].LockIndex = LockIndex;
+		++Stats.KeyCount;
+
+		// Lock the exit, which is the entrance of the next golden path room.
+		for (FDungeonDoor& Door : Doors)
+		{
+			if (Door.EntranceOf == LockedRoom + 1)
+			{
+				Door.LockIndex = LockIndex;
+				break;
+			}
+		}
+	}
+
+	Stats.bKeysSatisfied = Stats.KeyCount == Locks.Num();
+}
+
+void FDungeonLayout::PlaceTreasure(const FDungeonConstraints& Constraints, FRandomStream& Stream)
+{
+	if (Constraints.TreasureCount > 0)
+	{
+		// Terminals follow the golden path; any without a role can hold treasure.
+		TArray<int32, TMemStackAllocator<>> Candidates;
+
+		for (int32 RoomIndex = Stats.GoldenLength; RoomIndex < Rooms.Num(); RoomIndex++)
+		{
+			if (Rooms[RoomIndex].Role == ERoomRole::None)
+			{
+				Candidates.Add(RoomIndex);
+			}
+		}
+
+		while (Stats.TreasureCount < Constraints.TreasureCount && !Candidates.IsEmpty())
+		{
+			const int32 Pick = Stream.RandHelper(Candidates.Num());
+			Rooms[Candidates[Pick]].Role = ERoomRole::Treasure;
+			Candidates.RemoveAtSwap(Pick, 1, false);
+			++Stats.TreasureCount;
+		}
+	}
+
+	Stats.bTreasureSatisfied = Stats.TreasureCount >= Constraints.TreasureCount;
+}
+
+void FDungeonLayout::BackfillPath(const FDungeonTileset& Tileset, FRandomStream& Stream, const FDoorMaskArray& GoldenEmptyDoors)
+{
+	// Now do another pass to fill holes. Only the golden path is
+	// visited; terminals appended below are never backfilled.
+	for (int32 RoomIndex = 0; RoomIndex < GoldenEmptyDoors.Num(); RoomIndex++)
+	{
+		int32 EmptyDoors = GoldenEmptyDoors[RoomIndex];
+
+		// Loop until all doors are filled.
+		while (EmptyDoors != 0)
+		{
+			// Randomly select one of the remaining doors, as above.
+			const int32 CurrentDoor = RoomDoors::SelectRandom(EmptyDoors, Stream);
+			EmptyDoors &= ~CurrentDoor;
+
+			if (TryPlaceTerminal(Tileset, Stream, RoomIndex, CurrentDoor) != INDEX_NONE)
+			{
+				continue;
+			}
+
+			// We can't put a room here, so seal the doorway instead.
+			FDungeonDoor Door;
+			Door.OwnerRoom = RoomIndex;
+			Door.DoorFlag = CurrentDoor;
+			Door.bSealed = true;
+			Doors.Emplace(Door);
+			++Stats.SealedCount;
+		}
+	}
+}
+
+/** Tag at the start of saved layout data. */
+static constexpr uint32 LayoutMagic = 0x594C4744; // "DGLY"
+
+/** Bumped whenever the saved layout format changes. */
+static constexpr uint8 LayoutVersion = 3;
+
+/** How a saved door relates to the rooms around it. */
+enum class ESavedDoorKind : uint8
+{
+	/** Leads into the next golden path room. */
+	Golden,
+
+	/** Leads into a terminal. */
+	Terminal,
+
+	/** Sealed doorway. */
+	Sealed,
+
+	/** Golden path exit with nothing behind it. */
+	Exit,
+};
+
+/** Bits of a saved door's byte above its door index and kind. Locks and keys are followed by their lock index. */
+static constexpr uint8 SavedDoorLocked = 1 << 5;
+static constexpr uint8 SavedDoorKey = 1 << 6;
+static constexpr uint8 SavedDoorTreasure = 1 << 7;
+
+/** Bits of the saved solve flags. */
+static constexpr uint8 SavedReachedLength = 1 << 0;
+static constexpr uint8 SavedKeysSatisfied = 1 << 1;
+static constexpr uint8 SavedTreasureSatisfied = 1 << 2;
+static constexpr uint8 SavedBranchesSatisfied = 1 << 3;
+
+/** Appends a variable-length unsigned integer, seven bits per byte. */
+static void WriteVarInt(TArray<uint8>& Data, uint32 Value)
+{
+	while (Value >= 0x80)
+	{
+		Data.Add((uint8)(Value | 0x80));
+		Value >>= 7;
+	}
+
+	Data.Add((uint8)Value);
+}
+
+/** Appends the raw bytes of a trivially copyable value. */
+template <typename T>
+static void WriteRaw(TArray<uint8>& Data, const T& Value)
+{
+	Data.Append((const uint8*)&Value, sizeof(T));
+}
+
+/** Reads values written by the helpers above, directly from the source memory. */
+struct FLayoutReader
+{
+	TConstArrayView<uint8> Data;
+	int32 Offset = 0;
+	bool bError = false;
+
+	uint32 ReadVarInt()
+	{
+		uint32 Value = 0;
+
+		for (int32 Shift = 0; Shift < 35; Shift += 7)
+		{
+			if (Offset >= Data.Num())
+			{
+				bError = true;
+				return 0;
+			}
+
+			const uint8 Byte = Data[Offset++];
+			Value |= (uint32)(Byte & 0x7F) << Shift;
+
+			if ((Byte & 0x80) == 0)
+			{
+				return Value;
+			}
+		}
+
+		bError = true;
+		return 0;
+	}
+
+	template <typename T>
+	T ReadRaw()
+	{
+		T Value {};
+
+		if (Offset + (int32)sizeof(T) > Data.Num())
+		{
+			bError = true;
+			return Value;
+		}
+
+		FMemory::Memcpy(&Value, Data.GetData() + Offset, sizeof(T));
+		Offset += sizeof(T);
+		return Value;
+	}
+};
+
+void FDungeonLayout::Save(const FDungeonTileset& Tileset, TArray<uint8>& OutData) const
+{
+	OutData.Reset();
+
+	WriteRaw(OutData, LayoutMagic);
+	WriteRaw(OutData, LayoutVersion);
+	WriteRaw(OutData, Tileset.GetContentHash());
+
+	// The start room's transform anchors everything else.
+	WriteRaw(OutData, Origin.GetLocation());
+	WriteRaw(OutData, Origin.GetRotation());
+	WriteRaw(OutData, Origin.GetScale3D());
+
+	WriteRaw(OutData, SpawnSeed);
+	WriteRaw(OutData, (uint8)((Stats.bReachedLength ? SavedReachedLength : 0)
+		| (Stats.bKeysSatisfied ? SavedKeysSatisfied : 0)
+		| (Stats.bTreasureSatisfied ? SavedTreasureSatisfied : 0)
+		| (Stats.bBranchesSatisfied ? SavedBranchesSatisfied : 0)));
+
+	WriteVarInt(OutData, Rooms.Num());
+	WriteVarInt(OutData, Doors.Num());
+
+	for (const FDungeonRoom& Room : Rooms)
+	{
+		WriteVarInt(OutData, Room.TileIndex);
+	}
+
+	// Doors of the same room are mostly adjacent, so owners are stored as
+	// zigzagged deltas that nearly always fit in one byte.
+	int32 PreviousOwner = 0;
+
+	for (const FDungeonDoor& Door : Doors)
+	{
+		ESavedDoorKind Kind = ESavedDoorKind::Exit;
+
+		if (Door.bSealed)
+		{
+			Kind = ESavedDoorKind::Sealed;
+		}
+		else if (Door.LeadsTo != INDEX_NONE)
+		{
+			Kind = Door.EntranceOf != INDEX_NONE ? ESavedDoorKind::Golden : ESavedDoorKind::Terminal;
+		}
+
+		const int32 Delta = Door.OwnerRoom - PreviousOwner;
+		WriteVarInt(OutData, ((uint32)Delta << 1) ^ (uint32)(Delta >> 31));
+		PreviousOwner = Door.OwnerRoom;
+
+		uint8 Packed = (uint8)(RoomDoors::IndexOf(Door.DoorFlag) | ((uint8)Kind << 3));
+		int32 LockIndex = Door.LockIndex;
+
+		if (LockIndex != INDEX_NONE)
+		{
+			Packed |= SavedDoorLocked;
+		}
+
+		// Roles belong to terminals, which are only ever entered through this door.
+		if (Kind == ESavedDoorKind::Terminal)
+		{
+			const FDungeonRoom& Terminal = Rooms[Door.LeadsTo];
+
+			if (Terminal.Role == ERoomRole::Key)
+			{
+				Packed |= SavedDoorKey;
+				LockIndex = Terminal.LockIndex;
+			}
+			else if (Terminal.Role == ERoomRole::Treasure)
+			{
+				Packed |= SavedDoorTreasure;
+			}
+		}
+
+		WriteRaw(OutData, Packed);
+
+		if (Packed & (SavedDoorLocked | SavedDoorKey))
+		{
+			WriteVarInt(OutData, LockIndex);
+		}
+	}
+}
+
+bool FDungeonLayout::Load(const FDungeonTileset& Tileset, TConstArrayView<uint8> Data)
+{
+	Reset();
+
+	FLayoutReader Reader { Data };
+
+	if (Reader.ReadRaw<uint32>() != LayoutMagic || Reader.ReadRaw<uint8>() != LayoutVersion
+		|| Reader.ReadRaw<uint32>() != Tileset.GetContentHash())
+	{
+		return false;
+	}
+
+	const FVector Location = Reader.ReadRaw<FVector>();
+	FQuat Rotation = Reader.ReadRaw<FQuat>();
+	const FVector Scale = Reader.ReadRaw<FVector>();
+
+	// Saved rotations are unit length; anything else is corrupt. Renormalize
+	// the rest so that rounding never skews the room transforms.
+	if (Location.ContainsNaN() || Scale.ContainsNaN() || Rotation.ContainsNaN() || !Rotation.IsNormalized())
+	{
+		return false;
+	}
+
+	Rotation.Normalize();
+
+	SpawnSeed = Reader.ReadRaw<uint32>();
+	const uint8 SolveFlags = Reader.ReadRaw<uint8>();
+	Stats.bReachedLength = (SolveFlags & SavedReachedLength) != 0;
+	Stats.bKeysSatisfied = (SolveFlags & SavedKeysSatisfied) != 0;
+	Stats.bTreasureSatisfied = (SolveFlags & SavedTreasureSatisfied) != 0;
+	Stats.bBranchesSatisfied = (SolveFlags & SavedBranchesSatisfied) != 0;
+
+	const int32 RoomCount = (int32)Reader.ReadVarInt();
+	const int32 DoorCount = (int32)Reader.ReadVarInt();
+
+	// Every room and door takes at least a byte, which bounds bogus counts.
+	// Summed in 64 bits so that huge counts cannot wrap past the check.
+	// Doors always belong to a room, so there are none without rooms.
+	if (Reader.bError || RoomCount < 0 || DoorCount < 0 || (int64)RoomCount + DoorCount > Data.Num() - Reader.Offset
+		|| (RoomCount == 0 && DoorCount > 0))
+	{
+		Reset();
+		return false;
+	}
+
+	// The layout was reset on entry; only size it here, keeping the header read above.
+	Cells.Reset(RoomCount);
+	Doors.Reserve(DoorCount);
+	Rooms.SetNum(RoomCount);
+
+	for (FDungeonRoom& Room : Rooms)
+	{
+		Room.TileIndex = (int32)Reader.ReadVarInt();
+
+		if (!Tileset.Tiles.IsValidIndex(Room.TileIndex))
+		{
+			Reset();
+			return false;
+		}
+	}
+
+	Origin = FTransform(Rotation, Location, Scale);
+
+	if (RoomCount > 0)
+	{
+		Cells.TryOccupy(FIntVector::ZeroValue, Tileset.Tiles[Rooms[0].TileIndex].GetFootprint(0), 0);
+		Stats.GoldenLength = 1;
+	}
+
+	// Replay the doors with the solver's own math; each door leading
+	// somewhere places the next room in order.
+	int32 NextRoom = 1;
+	int32 Owner = 0;
+
+	for (int32 DoorIndex = 0; DoorIndex < DoorCount; DoorIndex++)
+	{
+		const uint32 ZigZag = Reader.ReadVarInt();
+		Owner += (int32)(ZigZag >> 1) ^ -(int32)(ZigZag & 1);
+
+		const uint8 Packed = Reader.ReadRaw<uint8>();
+		const ESavedDoorKind Kind = (ESavedDoorKind)((Packed >> 3) & 3);
+		const bool bHasLockIndex = (Packed & (SavedDoorLocked | SavedDoorKey)) != 0;
+		const int32 LockIndex = bHasLockIndex ? (int32)Reader.ReadVarInt() : INDEX_NONE;
+
+		// Only exits of the golden path lock, and only terminals hold a single role.
+		const bool bValidLock = !(Packed & SavedDoorLocked) || Kind == ESavedDoorKind::Golden || Kind == ESavedDoorKind::Exit;
+		const bool bValidRole = !(Packed & (SavedDoorKey | SavedDoorTreasure))
+			|| (Kind == ESavedDoorKind::Terminal && (Packed & (SavedDoorKey | SavedDoorTreasure)) != (SavedDoorKey | SavedDoorTreasure));
+
+		// The golden path only grows from its last room, before any terminal is placed.
+		const bool bValidOwner = Owner >= 0 && Owner < FMath::Min(NextRoom, Rooms.Num())
+			&& (Kind != ESavedDoorKind::Golden || (Owner == Stats.GoldenLength - 1 && NextRoom == Stats.GoldenLength));
+
+		if (Reader.bError || !bValidOwner || !bValidLock || !bValidRole || (bHasLockIndex && LockIndex < 0))
+		{
+			Reset();
+			return false;
+		}
+
+		const FDungeonRoom& OwnerRoom = Rooms[Owner];
+		const FDungeonTile& OwnerTile = Tileset.Tiles[OwnerRoom.TileIndex];
+
+		FDungeonDoor& Door = Doors.AddDefaulted_GetRef();
+		Door.OwnerRoom = Owner;
+		Door.DoorFlag = 1 << (Packed & 7);
+
+		if ((OwnerTile.DoorFlags & Door.DoorFlag) == 0)
+		{
+			Reset();
+			return false;
+		}
+
+		if (Kind == ESavedDoorKind::Sealed)
+		{
+			Door.bSealed = true;
+			++Stats.SealedCount;
+			continue;
+		}
+
+		Door.ExitOf = Owner;
+
+		if (Packed & SavedDoorLocked)
+		{
+			Door.LockIndex = LockIndex;
+		}
+
+		if (Kind == ESavedDoorKind::Exit)
+		{
+			continue;
+		}
+
+		if (NextRoom >= RoomCount)
+		{
+			Reset();
+			return false;
+		}
+
+		FDungeonRoom Placement = StepThroughDoor(OwnerTile, OwnerRoom, Door.DoorFlag);
+		const int32 OwnerPathIndex = OwnerRoom.PathIndex;
+
+		FDungeonRoom& Room = Rooms[NextRoom];
+		const FDungeonTile& RoomTile = Tileset.Tiles[Room.TileIndex];
+		EnterTile(RoomTile, Placement);
+
+		Room.GridCell = Placement.GridCell;
+		Room.Offset = Placement.Offset;
+		Room.Yaw = Placement.Yaw;
+		Door.LeadsTo = NextRoom;
+
+		if (Kind == ESavedDoorKind::Golden)
+		{
+			Room.PathIndex = NextRoom;
+			Door.EntranceOf = NextRoom;
+			++Stats.GoldenLength;
+		}
+		else
+		{
+			Room.PathIndex = OwnerPathIndex;
+			++Stats.TerminalCount;
+
+			if (Packed & SavedDoorKey)
+			{
+				Room.Role = ERoomRole::Key;
+				Room.LockIndex = LockIndex;
+				++Stats.KeyCount;
+			}
+			else if (Packed & SavedDoorTreasure)
+			{
+				Room.Role = ERoomRole::Treasure;
+				++Stats.TreasureCount;
+			}
+		}
+
+		if (!Cells.TryOccupy(Room.GridCell, RoomTile.GetFootprint(Room.Yaw), NextRoom))
+		{
+			Reset();
+			return false;
+		}
+
+		++NextRoom;
+	}
+
+	// Every room must have been placed, with no bytes left over.
+	if (NextRoom != FMath::Max(RoomCount, 1) || Reader.Offset != Data.Num())
+	{
+		Reset();
+		return false;
+	}
+
+	for (int32 RoomIndex = 0; RoomIndex < Rooms.Num(); RoomIndex++)
+	{
+		Rooms[RoomIndex].SpawnSeed = (int32)HashCombine(SpawnSeed, GetTypeHash(RoomIndex));
+	}
+
+	return true;
+}
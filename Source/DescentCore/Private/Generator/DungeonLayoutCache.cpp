@@ -0,0 +1,35 @@
+#include "Generator/DungeonLayoutCache.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+FString FDungeonLayoutCacheKey::GetFileName() const
+{
+	// Unconstrained layouts keep the names they were baked under.
+	const FString ConstraintSuffix = ConstraintHash ? FString::Printf(TEXT("_%08x"), ConstraintHash) : FString();
+	const FString BacktrackSuffix = bBacktrack ? FString::Printf(TEXT("_bt%d"), MaxBacktrackSteps) : FString();
+	return FString::Printf(TEXT("%08x_%08x_%d_%d%s%s.layout"), TilesetHash, OriginHash, Seed, GenerateLength, *BacktrackSuffix, *ConstraintSuffix);
+}
+
+FString FDungeonLayoutCache::GetBakedDirectory()
+{
+	return FPaths::ProjectContentDir() / TEXT("LayoutCache");
+}
+
+FString FDungeonLayoutCache::GetSavedDirectory()
+{
+	return FPaths::ProjectSavedDir() / TEXT("LayoutCache");
+}
+
+bool FDungeonLayoutCache::Find(const FDungeonLayoutCacheKey& Key, TArray<uint8>& OutData)
+{
+	const FString FileName = Key.GetFileName();
+
+	return FFileHelper::LoadFileToArray(OutData, *(GetBakedDirectory() / FileName), FILEREAD_Silent)
+		|| FFileHelper::LoadFileToArray(OutData, *(GetSavedDirectory() / FileName), FILEREAD_Silent);
+}
+
+bool FDungeonLayoutCache::Store(const FDungeonLayoutCacheKey& Key, const TArray<uint8>& Data, bool bBaked)
+{
+	const FString Directory = bBaked ? GetBakedDirectory() : GetSavedDirectory();
+	return FFileHelper::SaveArrayToFile(Data, *(Directory / Key.GetFileName()));
+}
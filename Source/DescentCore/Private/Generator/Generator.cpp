@@ -1,304 +1,897 @@
 #include "Generator/Generator.h"
 #include "Generator/RoomDoor.h"
 #include "Generator/RoomManager.h"
+#include "Generator/RoomOccupancySubsystem.h"
+#include "Pooling/ActorPoolSubsystem.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Components/SceneComponent.h"
+#include "Engine/AssetManager.h"
 #include "Engine/LevelStreamingDynamic.h"
+#include "Engine/StreamableManager.h"
 #include "Engine/World.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogGenerator, Log, All);
+
 AGenerator::AGenerator()
 {
 	PrimaryActorTick.bCanEverTick = true;
+
+	// Only ticks while an asynchronous generation is in flight.
+	PrimaryActorTick.bStartWithTickEnabled = false;
 }
 
-/** Helper struct representing an incomplete room. */
-struct FIntermediateRoomData
+void AGenerator::BeginPlay()
 {
-	ARoomManager* Manager = nullptr;
-	URoomData* RoomData = nullptr;
-	FTransform Transform;
-	FVector GridOffset;
-	int32 EmptyDoors = 0;
-	int32 PathIndex = 0;
-};
+	Super::BeginPlay();
+
+	if (PrewarmRoomCount > 0)
+	{
+		PrewarmPools(PrewarmRoomCount);
+	}
+}
+
+void AGenerator::PrewarmPools(int32 ExpectedRooms)
+{
+	UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
+
+	// Every room but the start has an entrance door, and most rooms seal a
+	// couple of doorways. Instanced doors and seals only need the odd actor.
+	Pool->Prewarm(ManagerClass, ExpectedRooms);
+	Pool->Prewarm(DoorClass, DoorMesh ? 0 : ExpectedRooms);
+	Pool->Prewarm(SealClass, SealMesh ? 0 : ExpectedRooms * 2);
+}
 
 void AGenerator::GenerateLevel()
 {
 	// Only invoke while there is no level.
-	if (HasGenerated())
+	if (HasGenerated() || IsGenerating())
 	{
 		return;
 	}
 
-	// Variables used in the generator loop.
-	FTransform RoomTransform = GetActorTransform();
-	URoomData* RoomSelection = GetRandomRoomTile(ERoomType::Start);
-	ARoomDoor* DoorActor = nullptr;
-	FVector CurrentOffset;
+	// Sort the tileset once so that every tile pick is constant time.
+	BuildDungeonTileset();
 
-	// No start room? Exit.
-	if (!RoomSelection)
+	// Skip the solve entirely if this layout was solved before.
+	if (bUseLayoutCache)
 	{
+		TArray<uint8> CachedData;
+
+		if (FDungeonLayoutCache::Find(MakeLayoutCacheKey(Seed), CachedData) && GenerateLevelFromData(CachedData))
+		{
+			return;
+		}
+	}
+
+	PendingLayout = MakeShared<FDungeonLayout, ESPMode::ThreadSafe>();
+	SpawnCursor = 0;
+	bStorePendingLayout = bUseLayoutCache;
+
+	const FDungeonSolveParams Params = MakeSolveParams(Seed);
+
+	if (bGenerateAsync)
+	{
+		// Solve on a worker and let Tick spawn the result. The
+		// task works on its own copy of the tileset.
+		SolveTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Layout = PendingLayout, Tiles = DungeonTileset, Params]()
+		{
+			Layout->Solve(Tiles, Params);
+		});
+
+		SetActorTickEnabled(true);
 		return;
 	}
 
-	// Track the generator's progress.
-	TArray<FIntermediateRoomData> ExistingRooms;
-	int32 RoomsRemaining = GenerateLength;
+	// Otherwise solve and spawn everything right now.
+	PendingLayout->Solve(DungeonTileset, Params);
+	SpawnPendingLayout();
+}
 
-	// Generate the golden path.
-	while (RoomsRemaining > 0)
+bool AGenerator::GenerateLevelFromData(const TArray<uint8>& Data)
+{
+	// Only invoke while there is no level.
+	if (HasGenerated() || IsGenerating())
 	{
-		bool LoadSuccess = false;
+		return false;
+	}
+
+	BuildDungeonTileset();
 
-		// Load the level using our currently-selected room and current room transform.
-		ULevelStreamingDynamic* Level = ULevelStreamingDynamic::LoadLevelInstanceBySoftObjectPtr(
-			this,
-			RoomSelection->Level,
-			RoomTransform,
-			LoadSuccess
-		);
+	TSharedPtr<FDungeonLayout, ESPMode::ThreadSafe> Layout = MakeShared<FDungeonLayout, ESPMode::ThreadSafe>();
 
-		// Save the level instance.
-		if (LoadSuccess)
+	if (!Layout->Load(DungeonTileset, Data))
+	{
+		return false;
+	}
+
+	PendingLayout = Layout;
+	SpawnCursor = 0;
+
+	// There's nothing to solve, so a previous task must not hold up spawning.
+	SolveTask = UE::Tasks::FTask();
+
+	if (bGenerateAsync)
+	{
+		SetActorTickEnabled(true);
+		return true;
+	}
+
+	SpawnPendingLayout();
+	return true;
+}
+
+int32 AGenerator::BakeLayoutCache(TConstArrayView<int32> Seeds)
+{
+	BuildDungeonTileset();
+
+	int32 Baked = 0;
+	FDungeonLayout Layout;
+	TArray<uint8> Data;
+
+	// Worlds that are loaded but never started don't register components, so
+	// the actor transform is still unset. Work it out from the placed
+	// transforms, which is what the same generator ends up with in play.
+	if (USceneComponent* Root = GetRootComponent())
+	{
+		Root->UpdateComponentToWorld();
+	}
+
+	for (int32 BakeSeed : Seeds)
+	{
+		if (Layout.Solve(DungeonTileset, MakeSolveParams(BakeSeed)) && IsLayoutCacheable(Layout))
 		{
-			LevelStreams.Add(Level);
+			Layout.Save(DungeonTileset, Data);
+			Baked += FDungeonLayoutCache::Store(MakeLayoutCacheKey(BakeSeed), Data, true) ? 1 : 0;
 		}
+	}
 
-		// Create a Room Manager and place it at the room's position.
-		ARoomManager* Manager = SpawnManager(RoomTransform);
+	return Baked;
+}
 
-		// Load the manager's entrance door.
-		Manager->EntranceDoor = DoorActor;
-
-		// We'll need this in a moment for bad reasons.
-		int32 South = (int32)ERoomDoorFlags::LowerDoorSouth;
-
-		// Store room data for collision and backfill.
-		FIntermediateRoomData NewRoomData;
-		NewRoomData.Manager = Manager;
-		NewRoomData.RoomData = RoomSelection;
-		NewRoomData.Transform = RoomTransform;
-		NewRoomData.GridOffset = CurrentOffset; // We always enter through the "southern" door, so exclude it.
-		NewRoomData.EmptyDoors = RoomSelection->DoorFlags - ((RoomSelection->DoorFlags & South) != 0 ? South : 0);
-		NewRoomData.PathIndex = GenerateLength - RoomsRemaining;
-
-		// Used to track doors.
-		FVector DoorPosition;
-		FVector DoorDirection;
-		int32 CurrentDoor = 0;
-		int32 IgnoreDoors = 0;
-		bool bDidCollide = false;
-
-		// Do-while loop that randomly picks a door and checks collisions.
-		// It will continue trying new doors until it finds one that can't collide.
-		// If all doors collide, then the generator will exit.
-		do
-		{
-			// Exit if there are no un-ignored doors.
-			// Ignored doors are confirmed to overlap.
-			if (NewRoomData.EmptyDoors - IgnoreDoors == 0)
-			{
-				// CurrentDoor = 0; // No door could be found.
-				break;
-			}
+FDungeonSolveParams AGenerator::MakeSolveParams(int32 SolveSeed) const
+{
+	FDungeonSolveParams Params;
+	Params.Origin = GetActorTransform();
+	Params.GenerateLength = GenerateLength;
+	Params.Seed = SolveSeed;
+	Params.bBacktrack = bBacktrackGoldenPath;
+	Params.MaxBacktrackSteps = MaxBacktrackSteps;
+	Params.Constraints = MakeSolveConstraints();
+	return Params;
+}
 
-			// Nested do-while loops; spicy isn't it?
-			// This loop randomly picks a door via a bit-shift.
-			// And ends when it finds an empty door slot.
-			do
-			{
-				CurrentDoor = 1 << FMath::RandRange(0, 7);
-			}
-			while ((NewRoomData.EmptyDoors - IgnoreDoors & CurrentDoor) == 0);
+FDungeonConstraints AGenerator::MakeSolveConstraints() const
+{
+	FDungeonConstraints SolveConstraints;
+	SolveConstraints.TreasureCount = Constraints.TreasureCount;
+	SolveConstraints.LockedPathIndices = Constraints.LockedPathIndices;
+	SolveConstraints.MinBranches = Constraints.MinBranches;
+	SolveConstraints.MaxAttempts = Constraints.MaxAttempts;
+	return SolveConstraints;
+}
 
-			// Once we have a "valid" door, calculate its world position and world direction vectors for collision checks.
-			RoomSelection->GetConnectionVectorsFor(RoomTransform, (ERoomDoorFlags)CurrentDoor, DoorPosition, DoorDirection);
+bool AGenerator::IsLayoutCacheable(const FDungeonLayout& Layout)
+{
+	// Failed or partial solves would otherwise be served for the seed from then on.
+	return !Layout.Rooms.IsEmpty() && Layout.Stats.GetSatisfiedCount() == 3;
+}
 
-			// Start with no collision.
-			bDidCollide = false;
+FDungeonLayoutCacheKey AGenerator::MakeLayoutCacheKey(int32 SolveSeed) const
+{
+	// Solver data alone misses changes to which levels the tiles stream.
+	uint32 TilesetHash = DungeonTileset.GetContentHash();
 
-			// Check the previous rooms for overlapping grid positions.
-			for (FIntermediateRoomData PrevRoom : ExistingRooms)
-			{
-				if (FVector::PointsAreSame(PrevRoom.GridOffset, CurrentOffset + DoorDirection))
-				{
-					IgnoreDoors += CurrentDoor; // Don't try this door again.
-					bDidCollide = true; // Repeat the loop to try again.
-					break; // Skip the remaining collisions.
-				}
-			}
-		}
-		while (bDidCollide);
+	for (const URoomData* Tile : DungeonTileAssets)
+	{
+		TilesetHash = HashCombine(TilesetHash, GetTypeHash(Tile->GetPathName()));
+		TilesetHash = HashCombine(TilesetHash, GetTypeHash(Tile->Level.ToSoftObjectPath().ToString()));
+	}
 
-		// Spawn an exit door and register it with the manager.
-		DoorActor = SpawnDoor(DoorPosition, DoorDirection);
-		Manager->ExitDoors.Emplace(DoorActor);
+	// The start room takes on the whole transform, scale included.
+	const FTransform OriginTransform = GetActorTransform();
+	const FVector OriginLocation = OriginTransform.GetLocation();
+	const FQuat OriginRotation = OriginTransform.GetRotation();
+	const FVector OriginScale = OriginTransform.GetScale3D();
+
+	FDungeonLayoutCacheKey Key;
+	Key.TilesetHash = TilesetHash;
+	Key.OriginHash = FCrc::MemCrc32(&OriginLocation, sizeof(FVector));
+	Key.OriginHash = FCrc::MemCrc32(&OriginRotation, sizeof(FQuat), Key.OriginHash);
+	Key.OriginHash = FCrc::MemCrc32(&OriginScale, sizeof(FVector), Key.OriginHash);
+	Key.Seed = SolveSeed;
+	Key.GenerateLength = GenerateLength;
+	Key.bBacktrack = bBacktrackGoldenPath;
+	Key.MaxBacktrackSteps = bBacktrackGoldenPath ? MaxBacktrackSteps : 0;
+	Key.ConstraintHash = MakeSolveConstraints().GetHash();
+	return Key;
+}
 
-		// Exclude the door we exit through.
-		NewRoomData.EmptyDoors -= CurrentDoor;
+void AGenerator::SolveLayouts(TConstArrayView<int32> Seeds, TArray<FDungeonLayout>& OutLayouts)
+{
+	BuildDungeonTileset();
 
-		// At last register the new room.
-		ExistingRooms.Emplace(NewRoomData);
+	TArray<FDungeonSolveParams> Params;
+	Params.Reserve(Seeds.Num());
 
-		// Update the room transform and the current offset to the next room position.
-		RoomTransform = RoomSelection->GetConnectionTransformFrom(DoorPosition, DoorDirection);
-		CurrentOffset += DoorDirection;
+	for (int32 SolveSeed : Seeds)
+	{
+		Params.Add(MakeSolveParams(SolveSeed));
+	}
 
-		// Decrement.
-		--RoomsRemaining;
+	FDungeonLayout::SolveBatch(DungeonTileset, Params, OutLayouts);
+}
 
-		// Pick a new connector room. If this is the last loop iteration, then select a boss room.
-		RoomSelection = GetRandomRoomTile(RoomsRemaining > 1 ? ERoomType::Connector : ERoomType::Boss);
+bool AGenerator::GenerateLevelFromLayout(const FDungeonLayout& Layout)
+{
+	// Only invoke while there is no level.
+	if (HasGenerated() || IsGenerating() || Layout.Rooms.IsEmpty())
+	{
+		return false;
+	}
 
-		// If we can't build the golden path any further 
-		// (no rooms available) then just cap it off.
-		if (!RoomSelection)
+	// Tile indices refer to the tileset the batch was solved with.
+	if (DungeonTileset.Tiles.IsEmpty())
+	{
+		BuildDungeonTileset();
+	}
+
+	PendingLayout = MakeShared<FDungeonLayout, ESPMode::ThreadSafe>(Layout);
+	SpawnCursor = 0;
+	SolveTask = UE::Tasks::FTask();
+
+	if (bGenerateAsync)
+	{
+		SetActorTickEnabled(true);
+		return true;
+	}
+
+	SpawnPendingLayout();
+	return true;
+}
+
+TArray<uint8> AGenerator::GetLayoutData() const
+{
+	return LayoutData;
+}
+
+void AGenerator::SpawnPendingLayout()
+{
+	// Finish the packages first, so that no room instance goes to disk on its own.
+	RequestLevelPackages(*PendingLayout);
+	WaitForLevelPackages();
+
+	while (SpawnLayoutStep())
+	{
+	}
+
+	FinishGeneration();
+}
+
+bool AGenerator::SpawnLayoutStep()
+{
+	const FDungeonLayout& Layout = *PendingLayout;
+	const int32 RoomCount = Layout.Rooms.Num();
+
+	// Rooms go first so that doors can register with their managers.
+	if (SpawnCursor < RoomCount)
+	{
+		const int32 RoomIndex = SpawnCursor++;
+		const FDungeonRoom& Room = Layout.Rooms[RoomIndex];
+		const FTransform RoomTransform = Layout.GetRoomTransform(RoomIndex);
+		URoomData* RoomData = DungeonTileAssets[Room.TileIndex];
+
+		FGeneratedRoomLevel& RoomLevel = RoomLevels.AddDefaulted_GetRef();
+		RoomLevel.TileIndex = Room.TileIndex;
+		RoomLevel.PathIndex = Room.PathIndex;
+		RoomLevel.Transform = RoomTransform;
+
+		// Streamed rooms are loaded once the players are known.
+		if (!bStreamRooms)
 		{
-			break;
+			LoadRoomLevel(RoomLevel, true);
 		}
+
+		// Create a Room Manager and place it at the room's position.
+		ARoomManager* Manager = SpawnManager(RoomTransform);
+
+		if (Manager)
+		{
+			Manager->Template = RoomData;
+			Manager->GridPosition = Room.GridCell;
+			Manager->RoomTransform = RoomTransform;
+			Manager->PathIndex = Room.PathIndex;
+			Manager->Role = Room.Role;
+			Manager->LockIndex = Room.LockIndex;
+			Manager->SpawnStream.Initialize(Room.SpawnSeed);
+			Manager->Generator = this;
+		}
+
+		// Room indices in the cell grid match the order used here.
+		RoomGrid.Emplace(Manager);
+		return true;
 	}
 
-	// Now do another pass to fill holes.
-	for (int32 Rooms = 0; Rooms < GenerateLength; Rooms++)
+	const int32 DoorIndex = SpawnCursor - RoomCount;
+
+	if (DoorIndex < Layout.Doors.Num())
 	{
-		// Extract the intermediate data for each room from the start.
-		FIntermediateRoomData RoomInfo = ExistingRooms[Rooms];
+		const FDungeonDoor& Door = Layout.Doors[DoorIndex];
+		++SpawnCursor;
 
-		// Redefine in scope.
-		FVector DoorPosition;
-		FVector DoorDirection;
-		int32 CurrentDoor = 0;
-		bool bDidCollide = false;
+		ARoomManager* Owner = RoomGrid.IsValidIndex(Door.ExitOf) ? RoomGrid[Door.ExitOf] : nullptr;
+		ARoomManager* Entered = RoomGrid.IsValidIndex(Door.EntranceOf) ? RoomGrid[Door.EntranceOf] : nullptr;
+		const FTransform DoorTransform = Layout.GetDoorTransform(DungeonTileset, DoorIndex);
 
-		// Loop until all doors are filled.
-		while (RoomInfo.EmptyDoors != 0)
+		// Seals never change, so they can simply be drawn.
+		if (Door.bSealed && SealMesh)
 		{
-			// Randomly select a door, using a similar rule as above.
-			// We don't need to worry about infinite loops here since
-			// the parent loop checks for the infinite condition.
-			do
+			PendingSeals.Add(DoorTransform);
+			return true;
+		}
+
+		// Open doors are drawn until their room needs an actor. Locked
+		// doors need one from the start to hold their lock.
+		if (!Door.bSealed && Door.LockIndex == INDEX_NONE && DoorMesh)
+		{
+			const int32 DoorwayIndex = Doorways.Num();
+			Doorways.AddDefaulted_GetRef().Transform = DoorTransform;
+
+			if (Owner)
 			{
-				CurrentDoor = 1 << FMath::RandRange(0, 7);
+				Owner->ExitDoorways.Add(DoorwayIndex);
 			}
-			while ((RoomInfo.EmptyDoors & CurrentDoor) == 0);
 
-			// Once we have a valid door, calculate its world position and world direction vectors for collision checks.
-			RoomInfo.RoomData->GetConnectionVectorsFor(RoomInfo.Transform, (ERoomDoorFlags)CurrentDoor, DoorPosition, DoorDirection);
+			if (Entered)
+			{
+				Entered->EntranceDoorway = DoorwayIndex;
+			}
 
-			// Start with no collision.
-			bDidCollide = false;
+			return true;
+		}
+
+		ARoomDoor* DoorActor = SpawnDoor(DoorTransform.GetLocation(), DoorTransform.GetRotation().Vector(), Door.bSealed);
 
-			// Check the previous rooms for overlapping grid positions.
-			for (FIntermediateRoomData PrevRoom : ExistingRooms)
+		if (DoorActor)
+		{
+			if (Owner)
 			{
-				if (FVector::PointsAreSame(PrevRoom.GridOffset, RoomInfo.GridOffset + DoorDirection))
-				{
-					bDidCollide = true; // Repeat the loop to try again.
-					break; // Skip the remaining collisions.
-				}
+				Owner->ExitDoors.Emplace(DoorActor);
 			}
 
-			if (bDidCollide)
+			if (Entered)
 			{
-				// We can't put a room here, so spawn a locked door actor instead.
-				SpawnDoor(DoorPosition, DoorDirection, true);
+				Entered->EntranceDoor = DoorActor;
 			}
-			else
+
+			if (Door.LockIndex != INDEX_NONE)
 			{
-				// We can put a room here, so pick a random terminal to fill in.
-				URoomData* TerminalRoom = GetRandomRoomTile(ERoomType::Terminal);
+				DoorActor->bRequiresKey = true;
+				DoorActor->SetLocked(true);
 
-				// No terminal? Put a door there instead.
-				if (!TerminalRoom)
+				if (LockedDoors.Num() <= Door.LockIndex)
 				{
-					SpawnDoor(DoorPosition, DoorDirection, true);
-					RoomInfo.EmptyDoors -= CurrentDoor;
-					continue;
+					LockedDoors.SetNum(Door.LockIndex + 1);
 				}
 
-				// We will need a terminal transform as well, so we calculate one from the current room.
-				FTransform TerminalTransform = RoomInfo.RoomData->GetConnectionTransformFrom(DoorPosition, DoorDirection);
+				LockedDoors[Door.LockIndex] = DoorActor;
+			}
+		}
 
-				bool LoadSuccess = false;
+		return true;
+	}
 
-				// Load the level using our currently-selected terminal and current room transform.
-				ULevelStreamingDynamic* Level = ULevelStreamingDynamic::LoadLevelInstanceBySoftObjectPtr(
-					this,
-					TerminalRoom->Level,
-					TerminalTransform,
-					LoadSuccess
-				);
+	return false;
+}
 
-				// Save the level instance.
-				if (LoadSuccess)
-				{
-					LevelStreams.Add(Level);
-				}
+void AGenerator::FinishGeneration()
+{
+	// Keep the layout around in its saved form for save games and late joiners.
+	PendingLayout->Save(DungeonTileset, LayoutData);
 
-				// Create another exit door and register it with the previous room manager.
-				ARoomDoor* ExitDoor = SpawnDoor(DoorPosition, DoorDirection);
-				RoomInfo.Manager->ExitDoors.Emplace(ExitDoor);
+	if (bStorePendingLayout && IsLayoutCacheable(*PendingLayout))
+	{
+		FDungeonLayoutCache::Store(MakeLayoutCacheKey(Seed), LayoutData);
+	}
 
-				// Now create another manager for the terminal and track it as well.
-				ARoomManager* Manager = SpawnManager(TerminalTransform);
+	bStorePendingLayout = false;
 
-				// We need to register the new terminal for collision.
-				FIntermediateRoomData TerminalData;
-				TerminalData.Manager = Manager;
-				TerminalData.RoomData = TerminalRoom;
-				TerminalData.Transform = TerminalTransform;
-				TerminalData.GridOffset = RoomInfo.GridOffset + DoorDirection;
-				TerminalData.PathIndex = RoomInfo.PathIndex;
+	RoomCells = MoveTemp(PendingLayout->Cells);
+	LastSolveStats = PendingLayout->Stats;
 
-				// Add it and we're done.
-				ExistingRooms.Emplace(TerminalData);
-			}
+	// Cells are sized after one cell of the start room's footprint; larger rooms cover several.
+	if (!PendingLayout->Rooms.IsEmpty())
+	{
+		const FDungeonRoom& StartRoom = PendingLayout->Rooms[0];
+		const FDungeonTile& StartTile = DungeonTileset.Tiles[StartRoom.TileIndex];
+		const float CellWidth = StartTile.RoomSize * 100.0f / StartTile.FootprintSize;
+		GridOrigin = PendingLayout->Origin.GetLocation();
+		GridRotation = PendingLayout->Origin.GetRotation();
+		GridCellSize = FVector(CellWidth, CellWidth, StartTile.RoomHeight * 100.0f / StartTile.FootprintFloors);
+	}
+
+	PendingLayout.Reset();
+	SpawnCursor = 0;
+
+	// Add every seal and doorway instance at once so each tree is built once.
+	if (SealMesh && !PendingSeals.IsEmpty())
+	{
+		SealInstances = SealInstances ? SealInstances : CreateInstanceComponent(SealMesh);
+		SealInstances->AddInstances(PendingSeals, false, true);
+		PendingSeals.Empty();
+	}
+
+	if (DoorMesh && !Doorways.IsEmpty())
+	{
+		TArray<FTransform> DoorwayTransforms;
+		DoorwayTransforms.Reserve(Doorways.Num());
 
-			// Mark the current door as filled.
-			RoomInfo.EmptyDoors -= CurrentDoor;
+		for (const FGeneratedDoorway& Doorway : Doorways)
+		{
+			DoorwayTransforms.Add(Doorway.Transform);
 		}
+
+		DoorInstances = DoorInstances ? DoorInstances : CreateInstanceComponent(DoorMesh);
+		DoorInstances->AddInstances(DoorwayTransforms, false, true);
 	}
 
-	// Transfer the intermediates to final data.
-	for (FIntermediateRoomData Intermediate : ExistingRooms)
+	// Hand room tracking over to the occupancy subsystem.
+	if (URoomOccupancySubsystem* Occupancy = GetWorld()->GetSubsystem<URoomOccupancySubsystem>())
 	{
-		ARoomManager* Manager = Intermediate.Manager;
-		Manager->Template = Intermediate.RoomData;
-		Manager->GridPosition = Intermediate.GridOffset;
-		Manager->RoomTransform = Intermediate.Transform;
-		Manager->PathIndex = Intermediate.PathIndex;
-		RoomGrid.Emplace(Manager);
+		Occupancy->RegisterGenerator(this);
+
+		if (bStreamRooms)
+		{
+			Occupancy->OnPawnRoomChanged.AddDynamic(this, &AGenerator::HandlePawnRoomChanged);
+		}
 	}
+
+	if (bStreamRooms)
+	{
+		UpdateRoomStreaming();
+	}
+
+	SetActorTickEnabled(false);
+	OnLevelGenerated.Broadcast();
+}
+
+void AGenerator::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!PendingLayout)
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	// Wait for the worker to finish the solve.
+	if (!SolveTask.IsCompleted())
+	{
+		return;
+	}
+
+	// Then for the layout's tile levels, so that no room instance goes to disk on its own.
+	if (SpawnCursor == 0)
+	{
+		RequestLevelPackages(*PendingLayout);
+
+		if (!AreLevelPackagesLoaded())
+		{
+			return;
+		}
+	}
+
+	// Spawn as much of the layout as fits in this frame's budget.
+	const double EndTime = FPlatformTime::Seconds() + SpawnBudgetMilliseconds / 1000.0;
+
+	while (SpawnLayoutStep())
+	{
+		if (FPlatformTime::Seconds() >= EndTime)
+		{
+			return;
+		}
+	}
+
+	FinishGeneration();
+}
+
+void AGenerator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Don't leave a solve running past the generator's lifetime.
+	if (SolveTask.IsValid())
+	{
+		SolveTask.Wait();
+	}
+
+	UnregisterOccupancy();
+	FlushLevelPackageCache();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AGenerator::ReleaseLevel()
 {
+	// Abandon any generation still in flight.
+	if (SolveTask.IsValid())
+	{
+		SolveTask.Wait();
+	}
+
+	PendingLayout.Reset();
+	SpawnCursor = 0;
+	bStorePendingLayout = false;
+	SetActorTickEnabled(false);
+
+	// Stop tracking the player before the rooms go away.
+	UnregisterOccupancy();
+
 	// These are technically weak pointers, so they need to go first.
 	RoomGrid.Empty();
+	LockedDoors.Empty();
+	RoomCells.Reset();
+	LayoutData.Empty();
+
+	// Return all of the actors to the pool. Since Managers are always
+	// emplaced before Doors, Managers should not be able to reference
+	// already released doors via this loop.
+	UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
 
-	// Unload all of the actors. Since Managers are always emplaced
-	// before Doors, Managers should not be able to reference already
-	// deleted doors via this loop.
 	for (AActor* Actor : ActorSpawns)
 	{
-		Actor->Destroy();
+		Pool->ReleaseActor(Actor);
 	}
 
 	// Unload all of the level streams.
-	for (ULevelStreamingDynamic* Level : LevelStreams)
+	for (const FGeneratedRoomLevel& RoomLevel : RoomLevels)
 	{
-		Level->SetIsRequestingUnloadAndRemoval(true);
+		if (RoomLevel.Level)
+		{
+			RoomLevel.Level->SetIsRequestingUnloadAndRemoval(true);
+		}
 	}
 
 	// Clear the arrays.
 	ActorSpawns.Empty();
-	LevelStreams.Empty();
+	RoomLevels.Empty();
+	PendingSeals.Empty();
+	Doorways.Empty();
+
+	if (SealInstances)
+	{
+		SealInstances->ClearInstances();
+	}
+
+	if (DoorInstances)
+	{
+		DoorInstances->ClearInstances();
+	}
+
+	RefreshRoomProxies();
+}
+
+void AGenerator::UpdateRoomStreaming()
+{
+	if (RoomLevels.IsEmpty())
+	{
+		return;
+	}
+
+	// Stream around every occupied room, or the start room until a player enters one.
+	TArray<int32, TInlineAllocator<4>> Anchors;
+
+	for (ARoomManager* Manager : RoomGrid)
+	{
+		if (Manager && Manager->IsPlayerInside())
+		{
+			Anchors.AddUnique(Manager->PathIndex);
+		}
+	}
+
+	if (Anchors.IsEmpty())
+	{
+		Anchors.Add(0);
+	}
+
+	/** A room the players want loaded. */
+	struct FWantedRoom
+	{
+		int32 RoomIndex;
+		int32 Distance;
+		bool bVisible;
+	};
+
+	TArray<FWantedRoom> Wanted;
+
+	for (int32 RoomIndex = 0; RoomIndex < RoomLevels.Num(); RoomIndex++)
+	{
+		// Terminals share their connector's path index, so branches come along for free.
+		int32 Nearest = MAX_int32;
+		int32 Ahead = MAX_int32;
+
+		for (int32 Anchor : Anchors)
+		{
+			const int32 Steps = RoomLevels[RoomIndex].PathIndex - Anchor;
+			Nearest = FMath::Min(Nearest, FMath::Abs(Steps));
+
+			if (Steps > 0)
+			{
+				Ahead = FMath::Min(Ahead, Steps);
+			}
+		}
+
+		if (Nearest <= StreamingDistance)
+		{
+			Wanted.Add({ RoomIndex, Nearest, true });
+		}
+		else if (Ahead <= StreamingDistance + PrefetchDistance)
+		{
+			Wanted.Add({ RoomIndex, Ahead, false });
+		}
+	}
+
+	// Visible rooms first, then by distance, so the budget drops far prefetches first.
+	Wanted.Sort([](const FWantedRoom& A, const FWantedRoom& B)
+	{
+		return A.bVisible != B.bVisible ? A.bVisible : A.Distance < B.Distance;
+	});
+
+	TBitArray<> Keep(false, RoomLevels.Num());
+	float Memory = 0.0f;
+
+	for (const FWantedRoom& Room : Wanted)
+	{
+		FGeneratedRoomLevel& RoomLevel = RoomLevels[Room.RoomIndex];
+		const float RoomMemory = DungeonTileAssets[RoomLevel.TileIndex]->MemoryEstimate;
+
+		// The occupied rooms themselves are always kept.
+		if (StreamingBudget > 0.0f && Room.Distance > 0 && Memory + RoomMemory > StreamingBudget)
+		{
+			continue;
+		}
+
+		Memory += RoomMemory;
+		Keep[Room.RoomIndex] = true;
+		LoadRoomLevel(RoomLevel, Room.bVisible);
+	}
+
+	// Unload everything else that was loaded before.
+	for (int32 RoomIndex = 0; RoomIndex < RoomLevels.Num(); RoomIndex++)
+	{
+		ULevelStreamingDynamic* Level = RoomLevels[RoomIndex].Level;
+
+		if (Level && !Keep[RoomIndex])
+		{
+			Level->SetShouldBeVisible(false);
+			Level->SetShouldBeLoaded(false);
+		}
+
+		RoomLevels[RoomIndex].bVisible = Keep[RoomIndex] && RoomLevels[RoomIndex].bVisible;
+	}
+
+	RefreshRoomProxies();
+}
+
+void AGenerator::RefreshRoomProxies()
+{
+	for (const TPair<UStaticMesh*, UHierarchicalInstancedStaticMeshComponent*>& Proxy : RoomProxies)
+	{
+		Proxy.Value->ClearInstances();
+	}
+
+	if (!bStreamRooms || !bDrawRoomProxies)
+	{
+		return;
+	}
+
+	// Gather the instances per mesh so each component is only rebuilt once.
+	TMap<UStaticMesh*, TArray<FTransform>> Instances;
+
+	for (const FGeneratedRoomLevel& RoomLevel : RoomLevels)
+	{
+		UStaticMesh* Mesh = DungeonTileAssets[RoomLevel.TileIndex]->ProxyMesh;
+
+		// Keep the proxy up until the level has actually appeared.
+		const bool bShowing = RoomLevel.bVisible && RoomLevel.Level && RoomLevel.Level->IsLevelVisible();
+
+		if (Mesh && !bShowing)
+		{
+			Instances.FindOrAdd(Mesh).Add(RoomLevel.Transform);
+		}
+	}
+
+	for (const TPair<UStaticMesh*, TArray<FTransform>>& MeshInstances : Instances)
+	{
+		UHierarchicalInstancedStaticMeshComponent*& Component = RoomProxies.FindOrAdd(MeshInstances.Key);
+
+		if (!Component)
+		{
+			Component = CreateInstanceComponent(MeshInstances.Key);
+		}
+
+		Component->AddInstances(MeshInstances.Value, false, true);
+	}
+}
+
+UHierarchicalInstancedStaticMeshComponent* AGenerator::CreateInstanceComponent(UStaticMesh* Mesh)
+{
+	// Instances are only there to be seen; door actors handle any gameplay.
+	UHierarchicalInstancedStaticMeshComponent* Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+	Component->SetStaticMesh(Mesh);
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Component->SetupAttachment(GetRootComponent());
+	Component->RegisterComponent();
+	return Component;
+}
+
+void AGenerator::HandleRoomLevelShown()
+{
+	RefreshRoomProxies();
+}
+
+void AGenerator::RequestLevelPackages(const FDungeonLayout& Layout)
+{
+	if (!bCacheLevelPackages)
+	{
+		return;
+	}
+
+	// Collect each distinct tile level, at the highest priority any of its rooms needs.
+	TMap<FSoftObjectPath, TAsyncLoadPriority> Requests;
+
+	for (int32 RoomIndex = 0; RoomIndex < Layout.Rooms.Num(); RoomIndex++)
+	{
+		const FSoftObjectPath Path = DungeonTileAssets[Layout.Rooms[RoomIndex].TileIndex]->Level.ToSoftObjectPath();
+
+		if (Path.IsNull() || LevelPackages.Contains(Path))
+		{
+			continue;
+		}
+
+		// Golden path rooms come first in the layout and load first.
+		const TAsyncLoadPriority Priority = RoomIndex < Layout.Stats.GoldenLength
+			? FStreamableManager::AsyncLoadHighPriority
+			: FStreamableManager::DefaultAsyncLoadPriority;
+
+		TAsyncLoadPriority& Requested = Requests.FindOrAdd(Path, Priority);
+		Requested = FMath::Max(Requested, Priority);
+	}
+
+	FStreamableManager& Streamable = UAssetManager::GetStreamableManager();
+
+	for (const TPair<FSoftObjectPath, TAsyncLoadPriority>& Request : Requests)
+	{
+		LevelPackages.Add(Request.Key, Streamable.RequestAsyncLoad(Request.Key, FStreamableDelegate(), Request.Value));
+	}
+}
+
+bool AGenerator::AreLevelPackagesLoaded() const
+{
+	for (const TPair<FSoftObjectPath, TSharedPtr<FStreamableHandle>>& Package : LevelPackages)
+	{
+		if (Package.Value && Package.Value->IsLoadingInProgress())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void AGenerator::WaitForLevelPackages()
+{
+	for (const TPair<FSoftObjectPath, TSharedPtr<FStreamableHandle>>& Package : LevelPackages)
+	{
+		if (Package.Value && Package.Value->IsLoadingInProgress())
+		{
+			Package.Value->WaitUntilComplete();
+		}
+	}
+}
+
+void AGenerator::FlushLevelPackageCache()
+{
+	for (const TPair<FSoftObjectPath, TSharedPtr<FStreamableHandle>>& Package : LevelPackages)
+	{
+		if (Package.Value)
+		{
+			Package.Value->ReleaseHandle();
+		}
+	}
+
+	LevelPackages.Empty();
+}
+
+void AGenerator::LoadRoomLevel(FGeneratedRoomLevel& RoomLevel, bool bVisible)
+{
+	RoomLevel.bVisible = bVisible;
+
+	// Reuse the level instance if the room was loaded before.
+	if (RoomLevel.Level)
+	{
+		RoomLevel.Level->SetShouldBeLoaded(true);
+		RoomLevel.Level->SetShouldBeVisible(bVisible);
+		return;
+	}
+
+	bool LoadSuccess = false;
+
+	// Load the level using the planned room and its transform.
+	ULevelStreamingDynamic* Level = ULevelStreamingDynamic::LoadLevelInstanceBySoftObjectPtr(
+		this,
+		DungeonTileAssets[RoomLevel.TileIndex]->Level,
+		RoomLevel.Transform,
+		LoadSuccess
+	);
+
+	// Save the level instance. The load itself is asynchronous, so hiding
+	// it here keeps prefetched rooms from ever showing up.
+	if (LoadSuccess)
+	{
+		RoomLevel.Level = Level;
+		Level->SetShouldBeVisible(bVisible);
+
+		if (bStreamRooms && bDrawRoomProxies)
+		{
+			Level->OnLevelShown.AddDynamic(this, &AGenerator::HandleRoomLevelShown);
+		}
+	}
+}
+
+void AGenerator::HandlePawnRoomChanged(APawn* Pawn, ARoomManager* PreviousRoom, ARoomManager* CurrentRoom)
+{
+	// Only react to moves within this generator's rooms.
+	if (RoomGrid.Contains(PreviousRoom) || RoomGrid.Contains(CurrentRoom))
+	{
+		UpdateRoomStreaming();
+	}
+}
+
+void AGenerator::UnregisterOccupancy()
+{
+	if (URoomOccupancySubsystem* Occupancy = GetWorld()->GetSubsystem<URoomOccupancySubsystem>())
+	{
+		// Unbind first; unregistering moves pawns out of the rooms.
+		Occupancy->OnPawnRoomChanged.RemoveDynamic(this, &AGenerator::HandlePawnRoomChanged);
+		Occupancy->UnregisterGenerator(this);
+	}
+}
+
+ARoomDoor* AGenerator::GetDoorwayActor(int32 DoorwayIndex)
+{
+	if (!Doorways.IsValidIndex(DoorwayIndex))
+	{
+		return nullptr;
+	}
+
+	FGeneratedDoorway& Doorway = Doorways[DoorwayIndex];
+
+	if (!Doorway.Actor)
+	{
+		const FTransform& Transform = Doorway.Transform;
+		Doorway.Actor = SpawnDoor(Transform.GetLocation(), Transform.GetRotation().Vector());
+
+		// Collapse the instance rather than removing it, so that the
+		// other instance indices keep matching their doorways.
+		if (Doorway.Actor && DoorInstances && DoorwayIndex < DoorInstances->GetInstanceCount())
+		{
+			DoorInstances->UpdateInstanceTransform(DoorwayIndex, FTransform(FQuat::Identity, Transform.GetLocation(), FVector::ZeroVector), true, true);
+		}
+	}
+
+	return Doorway.Actor;
+}
+
+const FTransform* AGenerator::GetDoorwayTransform(int32 DoorwayIndex) const
+{
+	return Doorways.IsValidIndex(DoorwayIndex) ? &Doorways[DoorwayIndex].Transform : nullptr;
 }
 
 ARoomDoor* AGenerator::SpawnDoor(const FVector& DoorPosition, const FVector& DoorDirection, bool bSpawnSealed)
 {
 	if (UClass* ActorClass = bSpawnSealed ? SealClass.Get() : DoorClass.Get())
 	{
-		ARoomDoor* Door = GetWorld()->SpawnActor<ARoomDoor>(ActorClass, DoorPosition, DoorDirection.Rotation());
+		UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
+		ARoomDoor* Door = Pool->Acquire<ARoomDoor>(ActorClass, FTransform(DoorDirection.Rotation(), DoorPosition));
 		ActorSpawns.Emplace(Door);
 		return Door;
 	}
@@ -310,7 +903,8 @@ ARoomManager* AGenerator::SpawnManager(const FTransform& RoomTransform)
 {
 	if (UClass* SpawnClass = ManagerClass.Get())
 	{
-		ARoomManager* Manager = GetWorld()->SpawnActor<ARoomManager>(SpawnClass, RoomTransform);
+		UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
+		ARoomManager* Manager = Pool->Acquire<ARoomManager>(SpawnClass, RoomTransform);
 		ActorSpawns.Emplace(Manager);
 		return Manager;
 	}
@@ -318,31 +912,109 @@ ARoomManager* AGenerator::SpawnManager(const FTransform& RoomTransform)
 	return nullptr;
 }
 
-URoomData* AGenerator::GetRandomRoomTile(ERoomType RoomType, int32 MaxTries) const
+void AGenerator::BuildDungeonTileset()
 {
-	URoomData* RoomSelected = nullptr;
+	DungeonTileset.Tiles.Reset(Tileset.Num());
+	DungeonTileAssets.Reset(Tileset.Num());
+
+	for (URoomData* Tile : Tileset)
+	{
+		if (Tile)
+		{
+			DungeonTileset.Tiles.Add(Tile->GetDungeonTile());
+			DungeonTileAssets.Add(Tile);
+		}
+	}
+
+	DungeonTileset.Build();
+
+	// The grid's cell size comes from the start room, so every tile must
+	// split its size into cells the same way. Drop the tiles that don't.
+	const FDungeonTile* Reference = DungeonTileset.Tiles.FindByPredicate([](const FDungeonTile& Tile) { return Tile.RoomType == ERoomType::Start; });
+
+	if (!Reference)
+	{
+		return;
+	}
 
-	do
+	const FDungeonTile CellTile = *Reference;
+	bool bDropped = false;
+
+	for (int32 TileIndex = DungeonTileset.Tiles.Num() - 1; TileIndex >= 0; TileIndex--)
 	{
-		// Select a random room and confirm that its type matches.
-		RoomSelected = Tileset[FMath::RandRange(0, Tileset.Num() - 1)];
-		--MaxTries;
+		const FDungeonTile& Tile = DungeonTileset.Tiles[TileIndex];
 
-		// Exit if we exceed the trial count.
-		// This is only here to prevent the
-		// possibility of an infinite loop.
-		if (MaxTries < 0)
+		if (Tile.RoomSize * CellTile.FootprintSize != CellTile.RoomSize * Tile.FootprintSize
+			|| Tile.RoomHeight * CellTile.FootprintFloors != CellTile.RoomHeight * Tile.FootprintFloors)
 		{
-			return nullptr;
+			UE_LOG(LogGenerator, Error, TEXT("Ignoring tile %s: %dm over %d cells and %dm over %d floors does not match the start room's %dm over %d cells and %dm over %d floors."),
+				*GetNameSafe(DungeonTileAssets[TileIndex]), Tile.RoomSize, Tile.FootprintSize, Tile.RoomHeight, Tile.FootprintFloors,
+				CellTile.RoomSize, CellTile.FootprintSize, CellTile.RoomHeight, CellTile.FootprintFloors);
+
+			DungeonTileset.Tiles.RemoveAt(TileIndex, 1, false);
+			DungeonTileAssets.RemoveAt(TileIndex, 1, false);
+			bDropped = true;
 		}
+	}
 
+	if (bDropped)
+	{
+		DungeonTileset.Build();
 	}
-	while (RoomSelected->RoomType != RoomType);
+}
+
+FGenerationReport AGenerator::GetGenerationReport() const
+{
+	FGenerationReport Report;
+	Report.bKeysSatisfied = LastSolveStats.bKeysSatisfied;
+	Report.bTreasureSatisfied = LastSolveStats.bTreasureSatisfied;
+	Report.bBranchesSatisfied = LastSolveStats.bBranchesSatisfied;
+	Report.bReachedLength = LastSolveStats.bReachedLength;
+	Report.KeyCount = LastSolveStats.KeyCount;
+	Report.TreasureCount = LastSolveStats.TreasureCount;
+	Report.BranchCount = LastSolveStats.TerminalCount;
+	Report.Attempts = LastSolveStats.Attempts;
+	Report.SolveMilliseconds = (float)(LastSolveStats.SolveSeconds * 1000.0);
+	return Report;
+}
 
-	return RoomSelected;
+ARoomDoor* AGenerator::GetLockedDoor(int32 LockIndex) const
+{
+	return LockedDoors.IsValidIndex(LockIndex) ? LockedDoors[LockIndex] : nullptr;
 }
 
 bool AGenerator::HasGenerated() const
 {
-	return !LevelStreams.IsEmpty();
+	return !RoomLevels.IsEmpty();
+}
+
+bool AGenerator::IsGenerating() const
+{
+	return PendingLayout.IsValid();
+}
+
+ARoomManager* AGenerator::FindRoomAtCell(const FIntVector& Cell) const
+{
+	const int32 RoomIndex = RoomCells.FindRoom(Cell);
+	return RoomGrid.IsValidIndex(RoomIndex) ? RoomGrid[RoomIndex] : nullptr;
+}
+
+bool AGenerator::IsRoomLevelShown(const ARoomManager* Room) const
+{
+	// Room managers and room levels are spawned in the same order.
+	const int32 RoomIndex = Room ? RoomGrid.IndexOfByKey(Room) : INDEX_NONE;
+	const ULevelStreamingDynamic* Level = RoomLevels.IsValidIndex(RoomIndex) ? RoomLevels[RoomIndex].Level : nullptr;
+	return Level && Level->IsLevelVisible();
+}
+
+FIntVector AGenerator::GetCellAtLocation(const FVector& WorldLocation) const
+{
+	// Rooms are centered on their cell horizontally, but their floor sits at the bottom of it.
+	const FVector Local = GridRotation.UnrotateVector(WorldLocation - GridOrigin) / GridCellSize;
+	return FIntVector(FMath::RoundToInt(Local.X), FMath::RoundToInt(Local.Y), FMath::FloorToInt(Local.Z));
+}
+
+ARoomManager* AGenerator::FindRoomAtLocation(const FVector& WorldLocation) const
+{
+	return FindRoomAtCell(GetCellAtLocation(WorldLocation));
 }
@@ -0,0 +1,101 @@
+#include "Generator/PoissonDiskSampler.h"
+
+void FPoissonDiskSampler::Sample(const FBox& Bounds, float MinDistance, FRandomStream& Stream, TArray<FVector>& OutPoints, int32 MaxAttempts)
+{
+	OutPoints.Reset();
+
+	if (!Bounds.IsValid || MinDistance <= 0.0f)
+	{
+		return;
+	}
+
+	const FVector Size = Bounds.GetSize();
+
+	// Each background cell is small enough to hold at most one point.
+	const float CellSize = MinDistance / UE_SQRT_2;
+	const int32 Columns = FMath::Max(1, FMath::CeilToInt(Size.X / CellSize));
+	const int32 Rows = FMath::Max(1, FMath::CeilToInt(Size.Y / CellSize));
+
+	TArray<int32> Grid;
+	Grid.Init(INDEX_NONE, Columns * Rows);
+
+	TArray<int32> Active;
+
+	auto GetCell = [&](const FVector& Point, int32& OutColumn, int32& OutRow)
+	{
+		OutColumn = FMath::Clamp(FMath::FloorToInt((Point.X - Bounds.Min.X) / CellSize), 0, Columns - 1);
+		OutRow = FMath::Clamp(FMath::FloorToInt((Point.Y - Bounds.Min.Y) / CellSize), 0, Rows - 1);
+	};
+
+	auto AddPoint = [&](const FVector& Point)
+	{
+		int32 Column, Row;
+		GetCell(Point, Column, Row);
+
+		const int32 Index = OutPoints.Add(Point);
+		Grid[Row * Columns + Column] = Index;
+		Active.Add(Index);
+	};
+
+	auto IsFarEnough = [&](const FVector& Point)
+	{
+		int32 Column, Row;
+		GetCell(Point, Column, Row);
+
+		// Only the surrounding 5x5 cells can hold a point within range.
+		for (int32 Y = FMath::Max(Row - 2, 0); Y <= FMath::Min(Row + 2, Rows - 1); Y++)
+		{
+			for (int32 X = FMath::Max(Column - 2, 0); X <= FMath::Min(Column + 2, Columns - 1); X++)
+			{
+				const int32 Other = Grid[Y * Columns + X];
+
+				if (Other != INDEX_NONE && FVector::DistSquaredXY(Point, OutPoints[Other]) < MinDistance * MinDistance)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	};
+
+	auto RandomHeight = [&]()
+	{
+		return Stream.FRandRange(Bounds.Min.Z, Bounds.Max.Z);
+	};
+
+	AddPoint(FVector(Stream.FRandRange(Bounds.Min.X, Bounds.Max.X), Stream.FRandRange(Bounds.Min.Y, Bounds.Max.Y), RandomHeight()));
+
+	while (!Active.IsEmpty())
+	{
+		const int32 ActiveIndex = Stream.RandHelper(Active.Num());
+		const FVector Origin = OutPoints[Active[ActiveIndex]];
+		bool bPlaced = false;
+
+		// Try candidates in the ring between one and two spacings away.
+		for (int32 Attempt = 0; Attempt < MaxAttempts; Attempt++)
+		{
+			const float Angle = Stream.FRandRange(0.0f, 2.0f * PI);
+			const float Distance = Stream.FRandRange(MinDistance, 2.0f * MinDistance);
+			const FVector Candidate(Origin.X + Distance * FMath::Cos(Angle), Origin.Y + Distance * FMath::Sin(Angle), RandomHeight());
+
+			if (Candidate.X < Bounds.Min.X || Candidate.X > Bounds.Max.X || Candidate.Y < Bounds.Min.Y || Candidate.Y > Bounds.Max.Y)
+			{
+				continue;
+			}
+
+			if (IsFarEnough(Candidate))
+			{
+				AddPoint(Candidate);
+				bPlaced = true;
+				break;
+			}
+		}
+
+		// Retire points with no room left around them.
+		if (!bPlaced)
+		{
+			Active.RemoveAtSwap(ActiveIndex, 1, false);
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#include "Generator/RoomCellGrid.h"
+
+/** Returns a board mask of the columns below the given X. */
+static uint64 GetColumnsBelow(int32 X)
+{
+	return 0x0101010101010101ull * ((1ull << X) - 1);
+}
+
+/** Returns a board mask of the rows below the given Y. */
+static uint64 GetRowsBelow(int32 Y)
+{
+	return Y >= 8 ? ~0ull : (1ull << (8 * Y)) - 1;
+}
+
+template <typename FunctionType>
+void FRoomCellGrid::ForEachBoard(const FIntVector& Center, uint64 Footprint, FunctionType&& Function)
+{
+	// Cell of the footprint's bit zero, and the board holding it.
+	const int32 CornerX = Center.X - FRoomFootprint::Center;
+	const int32 CornerY = Center.Y - FRoomFootprint::Center;
+	const FIntVector Board(CornerX >> 3, CornerY >> 3, Center.Z);
+	const int32 ShiftX = CornerX & 7;
+	const int32 ShiftY = CornerY & 7;
+
+	// Split the footprint along the board edges it crosses.
+	const uint64 Left = Footprint & GetColumnsBelow(8 - ShiftX);
+	const uint64 Right = Footprint & ~GetColumnsBelow(8 - ShiftX);
+	const uint64 Columns[2] = { Left << ShiftX, ShiftX ? Right >> (8 - ShiftX) : 0 };
+
+	for (int32 OffsetX = 0; OffsetX < 2; OffsetX++)
+	{
+		const uint64 Lower = Columns[OffsetX] & GetRowsBelow(8 - ShiftY);
+		const uint64 Upper = Columns[OffsetX] & ~GetRowsBelow(8 - ShiftY);
+		const uint64 Pieces[2] = { Lower << (8 * ShiftY), ShiftY ? Upper >> (8 * (8 - ShiftY)) : 0 };
+
+		for (int32 OffsetY = 0; OffsetY < 2; OffsetY++)
+		{
+			if (Pieces[OffsetY] != 0)
+			{
+				Function(Board + FIntVector(OffsetX, OffsetY, 0), Pieces[OffsetY]);
+			}
+		}
+	}
+}
+
+void FRoomCellGrid::Reset(int32 ExpectedRooms)
+{
+	Cells.Reset();
+	Cells.Reserve(ExpectedRooms);
+	Boards.Reset();
+	Boards.Reserve(ExpectedRooms);
+}
+
+bool FRoomCellGrid::Overlaps(const FIntVector& Center, const FRoomFootprint& Footprint) const
+{
+	bool bOverlaps = false;
+
+	for (int32 Floor = 0; Floor < Footprint.Floors && !bOverlaps; Floor++)
+	{
+		ForEachBoard(Center + FIntVector(0, 0, Floor), Footprint.Cells, [this, &bOverlaps](const FIntVector& Board, uint64 Piece)
+		{
+			const uint64* Occupied = Boards.Find(Board);
+			bOverlaps |= Occupied && (*Occupied & Piece) != 0;
+		});
+	}
+
+	return bOverlaps;
+}
+
+int32 FRoomCellGrid::FindRoom(const FIntVector& Cell) const
+{
+	const int32* RoomIndex = Cells.Find(Cell);
+	return RoomIndex ? *RoomIndex : INDEX_NONE;
+}
+
+bool FRoomCellGrid::TryOccupy(const FIntVector& Center, const FRoomFootprint& Footprint, int32 RoomIndex)
+{
+	// Never overwrite an existing room.
+	if (Overlaps(Center, Footprint))
+	{
+		return false;
+	}
+
+	for (int32 Floor = 0; Floor < Footprint.Floors; Floor++)
+	{
+		const FIntVector FloorCenter = Center + FIntVector(0, 0, Floor);
+
+		ForEachBoard(FloorCenter, Footprint.Cells, [this](const FIntVector& Board, uint64 Piece)
+		{
+			Boards.FindOrAdd(Board) |= Piece;
+		});
+
+		// Index the covered cells for room lookups.
+		for (uint64 Remaining = Footprint.Cells; Remaining != 0; Remaining &= Remaining - 1)
+		{
+			const int32 Bit = (int32)FMath::CountTrailingZeros64(Remaining);
+			Cells.Add(FloorCenter + FIntVector((Bit & 7) - FRoomFootprint::Center, (Bit >> 3) - FRoomFootprint::Center, 0), RoomIndex);
+		}
+	}
+
+	return true;
+}
+
+void FRoomCellGrid::Release(const FIntVector& Center, const FRoomFootprint& Footprint)
+{
+	for (int32 Floor = 0; Floor < Footprint.Floors; Floor++)
+	{
+		const FIntVector FloorCenter = Center + FIntVector(0, 0, Floor);
+
+		ForEachBoard(FloorCenter, Footprint.Cells, [this](const FIntVector& Board, uint64 Piece)
+		{
+			if (uint64* Occupied = Boards.Find(Board))
+			{
+				*Occupied &= ~Piece;
+			}
+		});
+
+		for (uint64 Remaining = Footprint.Cells; Remaining != 0; Remaining &= Remaining - 1)
+		{
+			const int32 Bit = (int32)FMath::CountTrailingZeros64(Remaining);
+			Cells.Remove(FloorCenter + FIntVector((Bit & 7) - FRoomFootprint::Center, (Bit >> 3) - FRoomFootprint::Center, 0));
+		}
+	}
+}
+
+FIntVector FRoomCellGrid::ToCell(const FVector& GridVector)
+{
+	return FIntVector(
+		FMath::RoundToInt(GridVector.X),
+		FMath::RoundToInt(GridVector.Y),
+		FMath::RoundToInt(GridVector.Z)
+	);
+}
@@ -2,19 +2,58 @@
 
 ARoomDoor::ARoomDoor()
 {
+	// Only ticks while an animation is playing.
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+void ARoomDoor::SetLocked(bool bLocked)
+{
+	SetDoorState(IsOpen, bLocked);
+}
+
+void ARoomDoor::UseKey()
+{
+	bRequiresKey = false;
+	SetLocked(false);
 }
 
 void ARoomDoor::TryOpen(bool bIgnoreLock)
 {
 	// Open if the door is unlocked
 	// Open if we ignore the lock.
-	IsOpen = !IsLocked || bIgnoreLock;
+	SetDoorState(!IsLocked || bIgnoreLock, IsLocked);
 }
 
 void ARoomDoor::TryClose(bool bIgnoreLock)
 {
 	// Close if the door is locked.
 	// Close if do not ignore the lock.
-	IsOpen = IsLocked && !bIgnoreLock;
+	SetDoorState(IsLocked && !bIgnoreLock, IsLocked);
+}
+
+void ARoomDoor::SetAnimating(bool bAnimating)
+{
+	SetActorTickEnabled(bAnimating);
+}
+
+void ARoomDoor::OnReturnedToPool_Implementation()
+{
+	// Parked doors have no listeners to tell.
+	IsLocked = false;
+	IsOpen = false;
+	bRequiresKey = false;
+	SetAnimating(false);
+}
+
+void ARoomDoor::SetDoorState(bool bOpen, bool bLocked)
+{
+	if (IsOpen == bOpen && IsLocked == bLocked)
+	{
+		return;
+	}
+
+	IsOpen = bOpen;
+	IsLocked = bLocked;
+	OnDoorStateChanged.Broadcast(this, IsOpen, IsLocked);
 }
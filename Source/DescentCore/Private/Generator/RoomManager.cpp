@@ -1,53 +1,99 @@
 #include "Generator/RoomManager.h"
+#include "Generator/Generator.h"
 #include "Generator/RoomData.h"
 #include "Generator/RoomDoor.h"
+#include "Generator/SpawnPointSubsystem.h"
+#include "Pooling/ActorPoolSubsystem.h"
 #include "Engine/World.h"
-#include "GameFramework/Character.h"
-#include "Kismet/GameplayStatics.h"
 
 ARoomManager::ARoomManager()
 	: SpawnCenter(400, 0, 1000)
 	, SpawnExtent(400, 800, 100)
 {
+	// Player entrances are tracked by URoomOccupancySubsystem. The
+	// manager only ticks while spreading a spawn wave over frames.
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+void ARoomManager::SpawnDoorActors()
+{
+	if (!Generator)
+	{
+		return;
+	}
+
+	for (int32 Doorway : ExitDoorways)
+	{
+		if (ARoomDoor* DoorActor = Generator->GetDoorwayActor(Doorway))
+		{
+			ExitDoors.Emplace(DoorActor);
+		}
+	}
+
+	ExitDoorways.Empty();
+
+	if (EntranceDoorway != INDEX_NONE)
+	{
+		EntranceDoor = Generator->GetDoorwayActor(EntranceDoorway);
+		EntranceDoorway = INDEX_NONE;
+	}
 }
 
 void ARoomManager::LockRoom(bool bTryLockEntrance)
 {
+	SpawnDoorActors();
+
 	for (ARoomDoor* DoorActor : ExitDoors)
 	{
-		DoorActor->IsLocked = true;
+		DoorActor->SetLocked(true);
 		DoorActor->TryClose();
 	}
 
 	if (EntranceDoor && bTryLockEntrance)
 	{
-		EntranceDoor->IsLocked = true;
+		EntranceDoor->SetLocked(true);
 		EntranceDoor->TryClose();
 	}
 }
 
 void ARoomManager::UnlockRoom(bool bTryUnlockEntrance)
 {
+	SpawnDoorActors();
+
 	for (ARoomDoor* DoorActor : ExitDoors)
 	{
-		DoorActor->IsLocked = false;
+		if (!DoorActor->bRequiresKey)
+		{
+			DoorActor->SetLocked(false);
+		}
 	}
 
-	if (EntranceDoor && bTryUnlockEntrance)
+	if (EntranceDoor && bTryUnlockEntrance && !EntranceDoor->bRequiresKey)
 	{
-		EntranceDoor->IsLocked = false;
+		EntranceDoor->SetLocked(false);
 	}
 }
 
 void ARoomManager::BeginSpawn(const TArray<FSpawnParams>& SpawnSequence)
 {
 	// Clear the previous actor list if we respawn.
-	if (HasActiveSpawns())
+	if (HasActiveSpawns() || IsSpawning())
 	{
 		ClearSpawns();
 	}
 
+	// Cached points and fallback points are both relative to the manager.
+	const FTransform VolumeTransform = GetActorTransform();
+
+	// Evenly spaced points shared by every room of this template. A copy is
+	// kept so that points can be drawn without repeats.
+	const FSpawnPointSet& SpawnPointSet = GetWorld()->GetSubsystem<USpawnPointSubsystem>()->GetSpawnPoints(*this);
+	TArray<FVector> SpawnPoints = SpawnPointSet.Points;
+	const bool bPointsValidated = SpawnPointSet.bValidated;
+	int32 UsedSpawnPoints = 0;
+
+	// Plan the whole wave first so that spawning is a straight walk.
 	for (const FSpawnParams& Params : SpawnSequence)
 	{
 		// Skip this parameter group if there are no actor types.
@@ -59,124 +105,295 @@ void ARoomManager::BeginSpawn(const TArray<FSpawnParams>& SpawnSequence)
 		for (int i = 0; i < Params.SpawnCount; i++)
 		{
 			// Randomly select an actor class to spawn.
-			int32 Index = FMath::RandRange(0, Params.ActorTypes.Num() - 1);
+			int32 Index = SpawnStream.RandRange(0, Params.ActorTypes.Num() - 1);
 			UClass* SpawnClass = Params.ActorTypes[Index].Get();
 
 			if (SpawnClass)
 			{
-				// Extract some references for math use.
-				const FVector& VolumeLocation = GetActorLocation();
-				const FRotator& VolumeRotation = GetActorRotation();
-
-				// Calculate a random x and y location within the room bounds.
-				int32 LocationX = FMath::RandRange(SpawnCenter.X - SpawnExtent.X, SpawnCenter.X + SpawnExtent.X);
-				int32 LocationY = FMath::RandRange(SpawnCenter.Y - SpawnExtent.Y, SpawnCenter.Y + SpawnExtent.Y);
-				int32 LocationZ = FMath::RandRange(SpawnCenter.Z - SpawnExtent.Z, SpawnCenter.Z + SpawnExtent.Z);
+				FPlannedSpawn& Planned = PlannedSpawns.AddDefaulted_GetRef();
+				Planned.ActorClass = SpawnClass;
+				Planned.bRequireDestroy = Params.bRequireDestroy;
 
-				// Construct the actual spawn position vector.
-				FVector SpawnPoint = FVector(LocationX, LocationY, LocationZ);
-				SpawnPoint = VolumeRotation.RotateVector(SpawnPoint) + VolumeLocation;
-
-				FActorSpawnParameters Parameters;
-				Parameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+				if (UsedSpawnPoints < SpawnPoints.Num())
+				{
+					// Draw an unused cached point.
+					const int32 Pick = SpawnStream.RandRange(UsedSpawnPoints, SpawnPoints.Num() - 1);
+					SpawnPoints.Swap(UsedSpawnPoints, Pick);
 
-				// Actually spawn the actor in.
-				AActor* SpawnActor = GetWorld()->SpawnActor<AActor>(SpawnClass, SpawnPoint, VolumeRotation, Parameters);
+					Planned.Transform = FTransform(VolumeTransform.GetRotation(), VolumeTransform.TransformPosition(SpawnPoints[UsedSpawnPoints++]));
+					Planned.bPrevalidated = bPointsValidated;
+				}
+				else
+				{
+					// Out of cached points; fall back to a random point within the room bounds.
+					FVector SpawnPoint(
+						SpawnStream.FRandRange(SpawnCenter.X - SpawnExtent.X, SpawnCenter.X + SpawnExtent.X),
+						SpawnStream.FRandRange(SpawnCenter.Y - SpawnExtent.Y, SpawnCenter.Y + SpawnExtent.Y),
+						SpawnStream.FRandRange(SpawnCenter.Z - SpawnExtent.Z, SpawnCenter.Z + SpawnExtent.Z)
+					);
 
-				// Register the new actor.
-				SpawnActors.Emplace(SpawnActor);
+					Planned.Transform = FTransform(VolumeTransform.GetRotation(), VolumeTransform.TransformPosition(SpawnPoint));
+				}
 
+				// Required actors count from the start, so the gate can't
+				// open while part of the wave is still to come.
 				if (Params.bRequireDestroy)
 				{
-					FScriptDelegate ScriptDelegate;
-					ScriptDelegate.BindUFunction(this, TEXT("ReduceRequireCount")); // WARNING! HARD-CODED REFERENCE
-					SpawnActor->OnDestroyed.Add(ScriptDelegate);
 					++RequireCount;
 				}
 			}
 		}
 	}
 
+	SpawnActors.Reserve(PlannedSpawns.Num());
+
 	// Fire the event if no required enemies spawned.
 	if (RequireCount == 0)
 	{
 		OnPlayerKillRequired();
 	}
+
+	// Spread the wave over several frames if there is a budget.
+	if (SpawnBudgetMilliseconds > 0.0f)
+	{
+		SetActorTickEnabled(true);
+		return;
+	}
+
+	while (SpawnPlannedStep())
+	{
+	}
 }
 
-void ARoomManager::ClearSpawns()
+bool ARoomManager::SpawnPlannedStep()
 {
-	for (AActor* Actor : SpawnActors)
+	if (!PlannedSpawns.IsValidIndex(PlannedSpawnCursor))
 	{
-		Actor->Destroy();
+		return false;
 	}
 
-	SpawnActors.Empty();
+	const FPlannedSpawn& Planned = PlannedSpawns[PlannedSpawnCursor++];
+
+	// Cached points are already spaced and clear of the room's geometry.
+	FActorSpawnParameters Parameters;
+	Parameters.SpawnCollisionHandlingOverride = Planned.bPrevalidated
+		? ESpawnActorCollisionHandlingMethod::AlwaysSpawn
+		: ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	// Actually spawn the actor in, reusing a pooled one if possible.
+	UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
+	AActor* SpawnActor = Pool->Acquire(Planned.ActorClass, Planned.Transform, Parameters);
+
+	if (!SpawnActor)
+	{
+		// A required actor that never spawned can't be killed.
+		if (Planned.bRequireDestroy && --RequireCount == 0)
+		{
+			OnPlayerKillRequired();
+		}
+
+		return true;
+	}
+
+	// Register the new actor.
+	SpawnActors.Emplace(SpawnActor);
+
+	if (Planned.bRequireDestroy)
+	{
+		RequiredSpawns.Add(SpawnActor);
+
+		// One world-wide handler covers every required actor of the room.
+		if (!ActorDestroyedHandle.IsValid())
+		{
+			ActorDestroyedHandle = GetWorld()->AddOnActorDestroyedHandler(
+				FOnActorDestroyed::FDelegate::CreateUObject(this, &ARoomManager::HandleActorDestroyed)
+			);
+		}
+	}
+
+	return true;
 }
 
 void ARoomManager::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
-	CheckPlayerEntrance();
+
+	// Spawn as much of the wave as fits in this frame's budget.
+	const double EndTime = FPlatformTime::Seconds() + SpawnBudgetMilliseconds / 1000.0;
+
+	while (SpawnPlannedStep())
+	{
+		if (FPlatformTime::Seconds() >= EndTime)
+		{
+			return;
+		}
+	}
+
+	SetActorTickEnabled(false);
 }
 
-void ARoomManager::CheckPlayerEntrance()
+void ARoomManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	if (ACharacter* PlayerCharacter = UGameplayStatics::GetPlayerCharacter(this, 0))
-	{
-		bool bIsInRoom = true;
-		bool bNearDoor = false;
+	UnbindActorDestroyed();
 
-		FVector PlayerLocation = PlayerCharacter->GetActorLocation();
-		FVector RoomLocation = RoomTransform.GetLocation();
+	Super::EndPlay(EndPlayReason);
+}
 
-		// Escape if the player is too far away to be in
-		// the room (outside the encompassing circle).
-		FVector RoomDelta = PlayerLocation - RoomLocation;
-		float RoomRadius = Template->RoomSize * 75;
+void ARoomManager::ClearSpawns()
+{
+	UActorPoolSubsystem* Pool = GetWorld()->GetSubsystem<UActorPoolSubsystem>();
 
-		if (RoomDelta.SquaredLength() > RoomRadius * RoomRadius)
+	// Released actors aren't destroyed, so they don't count as killed.
+	for (const TWeakObjectPtr<AActor>& Actor : SpawnActors)
+	{
+		// Skip actors that were already killed.
+		if (Actor.IsValid())
 		{
-			return;
+			Pool->ReleaseActor(Actor.Get());
 		}
+	}
 
-		// Construct some intervals for a AABB check.
-		FFloatInterval RoomX, RoomY, RoomZ;
-		RoomX.Include(RoomLocation.X + Template->RoomSize * 50);
-		RoomX.Include(RoomLocation.X - Template->RoomSize * 50);
-		RoomY.Include(RoomLocation.Y + Template->RoomSize * 50);
-		RoomY.Include(RoomLocation.Y - Template->RoomSize * 50);
-		RoomZ.Include(RoomLocation.Z + Template->RoomHeight * 100);
-		RoomZ.Include(0);
+	SpawnActors.Empty();
+	PlannedSpawns.Empty();
+	PlannedSpawnCursor = 0;
+	RequiredSpawns.Empty();
+	RequireCount = 0;
 
-		// Make the AABB check to determine if the player is in the room.
-		bIsInRoom = RoomX.Contains(PlayerLocation.X) && RoomY.Contains(PlayerLocation.Y) && RoomZ.Contains(PlayerLocation.Z);
+	UnbindActorDestroyed();
+	SetActorTickEnabled(false);
+}
 
-		// If we have an entrance door, we should also check if the player is near it.
-		if (EntranceDoor)
-		{
-			FVector DoorDelta = PlayerLocation - EntranceDoor->GetActorLocation();
-			float DoorRadius = Template->RoomSize * 12.5f;
+void ARoomManager::NotifySpawnKilled(AActor* Actor)
+{
+	SpawnActors.RemoveSingleSwap(Actor);
+	ReduceRequireCount(Actor);
+}
 
-			bNearDoor = DoorDelta.SquaredLength() < DoorRadius * DoorRadius;
-		}
+void ARoomManager::OnReturnedToPool_Implementation()
+{
+	ClearSpawns();
 
-		// If the player is inside of the room, not near
-		// the entrance door, and has not already been
-		// registered as inside the room, then invoke
-		// the entrance event function.
-		if (bIsInRoom && !bNearDoor && !bPlayerInside)
-		{
-			OnPlayerEnterRoom();
-		}
+	Template = nullptr;
+	Generator = nullptr;
+	PathIndex = 0;
+	Role = ERoomRole::None;
+	LockIndex = INDEX_NONE;
+	EntranceDoor = nullptr;
+	EntranceDoorway = INDEX_NONE;
+	ExitDoors.Reset();
+	ExitDoorways.Reset();
+	Occupants.Reset();
+}
+
+bool ARoomManager::IsLocationInside(const FVector& Location) const
+{
+	if (!Template)
+	{
+		return false;
+	}
+
+	FVector RoomLocation = RoomTransform.GetLocation();
+
+	// Escape if the location is too far away to be in
+	// the room (outside the encompassing circle).
+	FVector RoomDelta = Location - RoomLocation;
+	float RoomRadius = Template->RoomSize * 75;
+
+	if (RoomDelta.SquaredLength() > RoomRadius * RoomRadius)
+	{
+		return false;
+	}
+
+	// Construct some intervals for a AABB check.
+	FFloatInterval RoomX, RoomY, RoomZ;
+	RoomX.Include(RoomLocation.X + Template->RoomSize * 50);
+	RoomX.Include(RoomLocation.X - Template->RoomSize * 50);
+	RoomY.Include(RoomLocation.Y + Template->RoomSize * 50);
+	RoomY.Include(RoomLocation.Y - Template->RoomSize * 50);
+	RoomZ.Include(RoomLocation.Z + Template->RoomHeight * 100);
+	RoomZ.Include(0);
+
+	// Make the AABB check to determine if the location is in the room.
+	if (!RoomX.Contains(Location.X) || !RoomY.Contains(Location.Y) || !RoomZ.Contains(Location.Z))
+	{
+		return false;
+	}
+
+	// If we have an entrance, we should also check if the location is near it.
+	// Instanced doorways have no actor yet, so use the doorway's own transform.
+	const FTransform* DoorwayTransform = Generator ? Generator->GetDoorwayTransform(EntranceDoorway) : nullptr;
+
+	if (EntranceDoor || DoorwayTransform)
+	{
+		FVector DoorDelta = Location - (EntranceDoor ? EntranceDoor->GetActorLocation() : DoorwayTransform->GetLocation());
+		float DoorRadius = Template->RoomSize * 12.5f;
+
+		return DoorDelta.SquaredLength() >= DoorRadius * DoorRadius;
+	}
+
+	return true;
+}
+
+void ARoomManager::NotifyPawnEnter(APawn* Pawn)
+{
+	if (!Pawn || Occupants.Contains(Pawn))
+	{
+		return;
+	}
+
+	Occupants.Add(Pawn);
+	OnPawnEnterRoom(Pawn);
+
+	// The room just became occupied.
+	if (Occupants.Num() == 1)
+	{
+		OnPlayerEnterRoom();
+	}
+}
+
+void ARoomManager::NotifyPawnExit(APawn* Pawn)
+{
+	// Destroyed pawns arrive as null; drop them along with the given pawn.
+	const int32 Removed = Occupants.RemoveAll([Pawn](const APawn* Occupant)
+	{
+		return Occupant == Pawn || !IsValid(Occupant);
+	});
+
+	if (Removed == 0)
+	{
+		return;
+	}
+
+	if (Pawn)
+	{
+		OnPawnExitRoom(Pawn);
+	}
 
-		// Update the tracker so that we can retrigger.
-		bPlayerInside = bIsInRoom && !bNearDoor;
+	// The last player just left.
+	if (Occupants.IsEmpty())
+	{
+		OnPlayerExitRoom();
 	}
 }
 
-void ARoomManager::ReduceRequireCount()
+void ARoomManager::HandleActorDestroyed(AActor* Actor)
+{
+	ReduceRequireCount(Actor);
+}
+
+void ARoomManager::ReduceRequireCount(AActor* Actor)
 {
+	// Ignore actors this room isn't waiting on.
+	if (RequiredSpawns.Remove(Actor) == 0)
+	{
+		return;
+	}
+
+	if (RequiredSpawns.IsEmpty())
+	{
+		UnbindActorDestroyed();
+	}
+
 	--RequireCount;
 
 	if (RequireCount == 0) // Invoke only once.
@@ -184,3 +401,13 @@ void ARoomManager::ReduceRequireCount()
 		OnPlayerKillRequired();
 	}
 }
+
+void ARoomManager::UnbindActorDestroyed()
+{
+	if (ActorDestroyedHandle.IsValid())
+	{
+		// Sic; this is the engine's spelling.
+		GetWorld()->RemoveOnActorDestroyededHandler(ActorDestroyedHandle);
+		ActorDestroyedHandle.Reset();
+	}
+}
@@ -0,0 +1,140 @@
+#include "Generator/RoomOccupancySubsystem.h"
+#include "Generator/Generator.h"
+#include "Generator/RoomManager.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+
+void URoomOccupancySubsystem::RegisterGenerator(AGenerator* Generator)
+{
+	Generators.AddUnique(Generator);
+}
+
+void URoomOccupancySubsystem::UnregisterGenerator(AGenerator* Generator)
+{
+	Generators.Remove(Generator);
+
+	// Pawns can't stay in rooms that are about to go away.
+	for (auto It = PawnRooms.CreateIterator(); It; ++It)
+	{
+		ARoomManager* Room = It.Value().Get();
+
+		if (Room && Generator->RoomGrid.Contains(Room))
+		{
+			APawn* Pawn = It.Key().Get();
+			It.RemoveCurrent();
+			SetPawnRoom(Pawn, Room, nullptr);
+		}
+	}
+}
+
+ARoomManager* URoomOccupancySubsystem::GetPawnRoom(APawn* Pawn) const
+{
+	const TWeakObjectPtr<ARoomManager>* Room = PawnRooms.Find(Pawn);
+	return Room ? Room->Get() : nullptr;
+}
+
+void URoomOccupancySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Generators.IsEmpty() && PawnRooms.IsEmpty())
+	{
+		return;
+	}
+
+	// Player states replicate to every machine, so this covers local and remote players alike.
+	AGameStateBase* GameState = GetWorld()->GetGameState();
+
+	if (!GameState)
+	{
+		return;
+	}
+
+	TSet<APawn*, DefaultKeyFuncs<APawn*>, TInlineSetAllocator<8>> SeenPawns;
+
+	// One pass over every player pawn, one cell lookup each.
+	for (APlayerState* PlayerState : GameState->PlayerArray)
+	{
+		APawn* Pawn = PlayerState ? PlayerState->GetPawn() : nullptr;
+
+		if (!Pawn)
+		{
+			continue;
+		}
+
+		SeenPawns.Add(Pawn);
+
+		ARoomManager* CurrentRoom = FindRoomContaining(Pawn->GetActorLocation());
+		ARoomManager* PreviousRoom = GetPawnRoom(Pawn);
+
+		if (CurrentRoom == PreviousRoom)
+		{
+			continue;
+		}
+
+		if (CurrentRoom)
+		{
+			PawnRooms.Add(Pawn, CurrentRoom);
+		}
+		else
+		{
+			PawnRooms.Remove(Pawn);
+		}
+
+		SetPawnRoom(Pawn, PreviousRoom, CurrentRoom);
+	}
+
+	// Pawns that died or left the game leave their rooms as well.
+	for (auto It = PawnRooms.CreateIterator(); It; ++It)
+	{
+		APawn* Pawn = It.Key().Get();
+
+		if (!Pawn || !SeenPawns.Contains(Pawn))
+		{
+			ARoomManager* Room = It.Value().Get();
+			It.RemoveCurrent();
+			SetPawnRoom(Pawn, Room, nullptr);
+		}
+	}
+}
+
+TStatId URoomOccupancySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URoomOccupancySubsystem, STATGROUP_Tickables);
+}
+
+bool URoomOccupancySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+ARoomManager* URoomOccupancySubsystem::FindRoomContaining(const FVector& Location) const
+{
+	for (const TWeakObjectPtr<AGenerator>& Generator : Generators)
+	{
+		ARoomManager* Room = Generator.IsValid() ? Generator->FindRoomAtLocation(Location) : nullptr;
+
+		if (Room && Room->IsLocationInside(Location))
+		{
+			return Room;
+		}
+	}
+
+	return nullptr;
+}
+
+void URoomOccupancySubsystem::SetPawnRoom(APawn* Pawn, ARoomManager* PreviousRoom, ARoomManager* NewRoom)
+{
+	if (PreviousRoom)
+	{
+		PreviousRoom->NotifyPawnExit(Pawn);
+	}
+
+	if (NewRoom)
+	{
+		NewRoom->NotifyPawnEnter(Pawn);
+	}
+
+	OnPawnRoomChanged.Broadcast(Pawn, PreviousRoom, NewRoom);
+}
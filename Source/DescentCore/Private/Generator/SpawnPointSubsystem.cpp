@@ -0,0 +1,71 @@
+#include "Generator/SpawnPointSubsystem.h"
+#include "Generator/Generator.h"
+#include "Generator/PoissonDiskSampler.h"
+#include "Generator/RoomData.h"
+#include "Generator/RoomManager.h"
+#include "Engine/World.h"
+
+const FSpawnPointSet& USpawnPointSubsystem::GetSpawnPoints(const ARoomManager& Manager)
+{
+	static const FSpawnPointSet NoPoints;
+
+	if (!Manager.Template)
+	{
+		return NoPoints;
+	}
+
+	FSpawnPointKey Key;
+	Key.Template = Manager.Template;
+	Key.Center = Manager.SpawnCenter;
+	Key.Extent = Manager.SpawnExtent;
+	Key.Spacing = Manager.SpawnPointSpacing;
+	Key.Radius = Manager.SpawnPointRadius;
+
+	FSpawnPointSet* Set = SpawnPoints.Find(Key);
+
+	if (!Set)
+	{
+		Set = &SpawnPoints.Add(Key);
+		SampleSpawnPoints(Manager, Set->Points);
+		Set->bValidated = Manager.SpawnPointRadius <= 0.0f;
+	}
+
+	// Overlap tests against a level that is not in the world yet pass every
+	// point, so wait for a room whose level is shown.
+	if (!Set->bValidated && Manager.Generator && Manager.Generator->IsRoomLevelShown(&Manager))
+	{
+		ValidateSpawnPoints(Manager, Set->Points);
+		Set->bValidated = true;
+	}
+
+	return *Set;
+}
+
+void USpawnPointSubsystem::ResetSpawnPoints()
+{
+	SpawnPoints.Empty();
+}
+
+void USpawnPointSubsystem::SampleSpawnPoints(const ARoomManager& Manager, TArray<FVector>& OutPoints)
+{
+	// Seed from the template's name so that every run samples the same points.
+	FRandomStream Stream(FCrc::StrCrc32(*Manager.Template->GetPathName()));
+
+	const FBox Volume = FBox::BuildAABB(Manager.SpawnCenter, Manager.SpawnExtent);
+	FPoissonDiskSampler::Sample(Volume, Manager.SpawnPointSpacing, Stream, OutPoints);
+}
+
+void USpawnPointSubsystem::ValidateSpawnPoints(const ARoomManager& Manager, TArray<FVector>& InOutPoints) const
+{
+	// Drop points that would spawn inside the room's geometry. Every
+	// instance of the template shares that geometry in room space.
+	const FCollisionShape Probe = FCollisionShape::MakeSphere(Manager.SpawnPointRadius);
+	const FTransform ManagerTransform = Manager.GetActorTransform();
+	const UWorld* World = GetWorld();
+
+	InOutPoints.RemoveAll([&](const FVector& Point)
+	{
+		const FVector WorldPoint = ManagerTransform.TransformPosition(Point);
+		return World->OverlapAnyTestByChannel(WorldPoint, FQuat::Identity, ECC_WorldStatic, Probe);
+	});
+}
@@ -0,0 +1,41 @@
+#include "Generator/SyntheticTileset.h"
+
+/** Creates a solver tile with the given type, doors and footprint, sized to keep one cell per 20 meters. */
+static FDungeonTile MakeTile(ERoomType RoomType, ERoomDoorFlags DoorFlags, float Weight = 1.0f, int32 FootprintSize = 1)
+{
+	FDungeonTile Tile;
+	Tile.RoomType = RoomType;
+	Tile.DoorFlags = (int32)DoorFlags;
+	Tile.Weight = Weight;
+	Tile.RoomSize *= FootprintSize;
+	Tile.FootprintSize = FootprintSize;
+	return Tile;
+}
+
+FDungeonTileset SyntheticTileset::Make(bool bMultiCellRooms)
+{
+	constexpr ERoomDoorFlags LowerDoorNorth = ERoomDoorFlags::LowerDoorNorth;
+	constexpr ERoomDoorFlags LowerDoorSouth = ERoomDoorFlags::LowerDoorSouth;
+	constexpr ERoomDoorFlags LowerDoorEast = ERoomDoorFlags::LowerDoorEast;
+	constexpr ERoomDoorFlags LowerDoorWest = ERoomDoorFlags::LowerDoorWest;
+	constexpr ERoomDoorFlags UpperDoorNorth = ERoomDoorFlags::UpperDoorNorth;
+
+	FDungeonTileset Tileset;
+	Tileset.Tiles.Add(MakeTile(ERoomType::Start, LowerDoorNorth | LowerDoorEast | LowerDoorWest));
+	Tileset.Tiles.Add(MakeTile(ERoomType::Connector, LowerDoorSouth | LowerDoorNorth, 4.0f));
+	Tileset.Tiles.Add(MakeTile(ERoomType::Connector, LowerDoorSouth | LowerDoorEast, 2.0f));
+	Tileset.Tiles.Add(MakeTile(ERoomType::Connector, LowerDoorSouth | LowerDoorWest, 2.0f));
+	Tileset.Tiles.Add(MakeTile(ERoomType::Connector, LowerDoorSouth | LowerDoorEast | LowerDoorWest));
+	Tileset.Tiles.Add(MakeTile(ERoomType::Connector, LowerDoorSouth | LowerDoorNorth | LowerDoorEast | LowerDoorWest));
+	Tileset.Tiles.Add(MakeTile(ERoomType::Connector, LowerDoorSouth | UpperDoorNorth, 0.5f));
+	Tileset.Tiles.Add(MakeTile(ERoomType::Terminal, LowerDoorSouth));
+	Tileset.Tiles.Add(MakeTile(ERoomType::Boss, LowerDoorSouth));
+
+	if (bMultiCellRooms)
+	{
+		Tileset.Tiles.Add(MakeTile(ERoomType::Connector, LowerDoorSouth | LowerDoorNorth | LowerDoorEast, 1.0f, 3));
+	}
+
+	Tileset.Build();
+	return Tileset;
+}
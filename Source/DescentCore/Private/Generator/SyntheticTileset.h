@@ -0,0 +1,16 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Generator/DungeonLayout.h"
+
+namespace SyntheticTileset
+{
+	/**
+	 * Builds a small solver tileset covering every room type, turns and
+	 * stairs, without any room assets. Shared by the generator benchmark
+	 * and the automation tests so that both solve the same rooms.
+	 *
+	 * @param bMultiCellRooms Whether to add a connector covering 3x3 cells.
+	 */
+	FDungeonTileset Make(bool bMultiCellRooms = false);
+}
@@ -6,8 +6,8 @@
 // Sets default values
 APickUpActors::APickUpActors()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Pickups have no per-frame work, so they never tick.
+	PrimaryActorTick.bCanEverTick = false;
 	
 	StaticMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Static Mesh"));
 	
@@ -33,11 +33,3 @@ void APickUpActors::BeginPlay()
 //{
 
 //}
-
-// Called every frame
-void APickUpActors::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-}
-
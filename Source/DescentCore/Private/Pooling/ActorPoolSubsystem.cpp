@@ -0,0 +1,200 @@
+#include "Pooling/ActorPoolSubsystem.h"
+#include "Pooling/PooledActorInterface.h"
+#include "Components/ActorComponent.h"
+#include "GameFramework/Actor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogActorPool, Log, All);
+
+AActor* UActorPoolSubsystem::Acquire(UClass* ActorClass, const FTransform& Transform, const FActorSpawnParameters& SpawnParameters)
+{
+	if (!ActorClass)
+	{
+		return nullptr;
+	}
+
+	FActorPoolBucket& Bucket = Buckets.FindOrAdd(ActorClass);
+
+	// Hand out the most recently parked actor that still exists.
+	while (!Bucket.Free.IsEmpty())
+	{
+		const FParkedActor Parked = Bucket.Free.Pop(false);
+		ParkedActors.Remove(Parked.Actor);
+		AActor* Actor = Parked.Actor.Get();
+
+		if (IsValid(Actor))
+		{
+			// Collision has to be back on for the placement checks to see the actor.
+			ActivateActor(Actor, Parked);
+			FTransform Placement = Transform;
+
+			// A blocked transform would block a fresh spawn too, so leave the actor parked.
+			if (!AdjustForCollision(Actor, SpawnParameters, Placement))
+			{
+				ParkActor(Bucket, Actor);
+				return nullptr;
+			}
+
+			++Bucket.Hits;
+			Actor->SetActorTransform(Placement, false, nullptr, ETeleportType::ResetPhysics);
+
+			if (Actor->Implements<UPooledActor>())
+			{
+				IPooledActor::Execute_OnAcquiredFromPool(Actor);
+			}
+
+			return Actor;
+		}
+	}
+
+	++Bucket.Misses;
+	return GetWorld()->SpawnActor<AActor>(ActorClass, Transform, SpawnParameters);
+}
+
+AActor* UActorPoolSubsystem::AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform)
+{
+	return Acquire(ActorClass.Get(), Transform);
+}
+
+void UActorPoolSubsystem::ReleaseActor(AActor* Actor)
+{
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+
+	// Parking an actor twice would hand it out to two acquirers.
+	if (ParkedActors.Contains(Actor))
+	{
+		UE_LOG(LogActorPool, Warning, TEXT("Ignoring release of %s, which is already in the pool."), *Actor->GetName());
+		return;
+	}
+
+	if (Actor->Implements<UPooledActor>())
+	{
+		IPooledActor::Execute_OnReturnedToPool(Actor);
+	}
+
+	ParkActor(Buckets.FindOrAdd(Actor->GetClass()), Actor);
+}
+
+void UActorPoolSubsystem::Prewarm(TSubclassOf<AActor> ActorClass, int32 Count)
+{
+	UClass* Class = ActorClass.Get();
+
+	if (!Class)
+	{
+		return;
+	}
+
+	const int32 Missing = Count - Buckets.FindOrAdd(Class).Free.Num();
+
+	// Spawn straight into the pool; these don't count as misses. The bucket is
+	// looked up again each time, since spawning may touch other pools.
+	for (int32 Index = 0; Index < Missing; Index++)
+	{
+		if (AActor* Actor = GetWorld()->SpawnActor<AActor>(Class, FTransform::Identity))
+		{
+			ParkActor(Buckets.FindOrAdd(Class), Actor);
+		}
+	}
+}
+
+int32 UActorPoolSubsystem::GetFreeCount(TSubclassOf<AActor> ActorClass) const
+{
+	const FActorPoolBucket* Bucket = Buckets.Find(ActorClass.Get());
+	return Bucket ? Bucket->Free.Num() : 0;
+}
+
+void UActorPoolSubsystem::GetPoolStats(TSubclassOf<AActor> ActorClass, int32& OutHits, int32& OutMisses) const
+{
+	const FActorPoolBucket* Bucket = Buckets.Find(ActorClass.Get());
+	OutHits = Bucket ? Bucket->Hits : 0;
+	OutMisses = Bucket ? Bucket->Misses : 0;
+}
+
+void UActorPoolSubsystem::GetTotalPoolStats(int32& OutHits, int32& OutMisses) const
+{
+	OutHits = 0;
+	OutMisses = 0;
+
+	for (const TPair<TObjectKey<UClass>, FActorPoolBucket>& Pair : Buckets)
+	{
+		OutHits += Pair.Value.Hits;
+		OutMisses += Pair.Value.Misses;
+	}
+}
+
+void UActorPoolSubsystem::ParkActor(FActorPoolBucket& Bucket, AActor* Actor)
+{
+	ParkedActors.Add(Actor);
+	Bucket.Free.Add(DeactivateActor(Actor));
+}
+
+FParkedActor UActorPoolSubsystem::DeactivateActor(AActor* Actor)
+{
+	FParkedActor Parked;
+	Parked.Actor = Actor;
+	Parked.bHidden = Actor->IsHidden();
+	Parked.bCollisionEnabled = Actor->GetActorEnableCollision();
+
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		Component->SetComponentTickEnabled(false);
+	}
+
+	return Parked;
+}
+
+void UActorPoolSubsystem::ActivateActor(AActor* Actor, const FParkedActor& Parked)
+{
+	Actor->SetActorHiddenInGame(Parked.bHidden);
+	Actor->SetActorEnableCollision(Parked.bCollisionEnabled);
+	Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		Component->SetComponentTickEnabled(Component->PrimaryComponentTick.bStartWithTickEnabled);
+	}
+}
+
+bool UActorPoolSubsystem::AdjustForCollision(AActor* Actor, const FActorSpawnParameters& SpawnParameters, FTransform& InOutTransform)
+{
+	// Mirror UWorld::SpawnActor: the override wins over the actor's own method.
+	const ESpawnActorCollisionHandlingMethod Method = SpawnParameters.SpawnCollisionHandlingOverride != ESpawnActorCollisionHandlingMethod::Undefined
+		? SpawnParameters.SpawnCollisionHandlingOverride
+		: Actor->SpawnCollisionHandlingMethod;
+
+	UWorld* World = Actor->GetWorld();
+	FVector Location = InOutTransform.GetLocation();
+	const FRotator Rotation = InOutTransform.Rotator();
+
+	switch (Method)
+	{
+	case ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn:
+		if (World->FindTeleportSpot(Actor, Location, Rotation))
+		{
+			InOutTransform.SetLocation(Location);
+		}
+
+		return true;
+
+	case ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding:
+		if (!World->FindTeleportSpot(Actor, Location, Rotation))
+		{
+			return false;
+		}
+
+		InOutTransform.SetLocation(Location);
+		return true;
+
+	case ESpawnActorCollisionHandlingMethod::DontSpawnIfColliding:
+		return !World->EncroachingBlockingGeometry(Actor, Location, Rotation);
+
+	default:
+		return true;
+	}
+}
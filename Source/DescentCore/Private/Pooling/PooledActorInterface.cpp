@@ -0,0 +1 @@
+#include "Pooling/PooledActorInterface.h"
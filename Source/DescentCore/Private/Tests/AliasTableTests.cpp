@@ -0,0 +1,74 @@
+#include "Generator/AliasTable.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AliasTableTests
+{
+	/** Samples the table many times and returns how often each entry came up. */
+	static TArray<double> MeasureFrequencies(const FAliasTable& Table, int32 SampleCount)
+	{
+		TArray<double> Frequencies;
+		Frequencies.SetNumZeroed(Table.Num());
+
+		FRandomStream Stream(1234);
+
+		for (int32 Sample = 0; Sample < SampleCount; Sample++)
+		{
+			Frequencies[Table.Sample(Stream)] += 1.0 / SampleCount;
+		}
+
+		return Frequencies;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAliasTableWeightsTest, "DescentCore.Generator.AliasTable.ReproducesWeights", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAliasTableWeightsTest::RunTest(const FString& Parameters)
+{
+	using namespace AliasTableTests;
+
+	constexpr int32 SampleCount = 400000;
+	constexpr double Tolerance = 0.005;
+
+	// Uneven weights, including one that must never come up.
+	const float Weights[] = { 1.0f, 0.0f, 3.0f, 6.0f, 0.5f, -2.0f };
+	const double Expected[] = { 1.0 / 10.5, 0.0, 3.0 / 10.5, 6.0 / 10.5, 0.5 / 10.5, 0.0 };
+
+	FAliasTable Table;
+	Table.Build(Weights);
+	TestEqual(TEXT("Entry count"), Table.Num(), (int32)UE_ARRAY_COUNT(Weights));
+
+	const TArray<double> Frequencies = MeasureFrequencies(Table, SampleCount);
+
+	for (int32 Index = 0; Index < Frequencies.Num(); Index++)
+	{
+		TestEqual(FString::Printf(TEXT("Frequency of entry %d"), Index), Frequencies[Index], Expected[Index], Tolerance);
+	}
+
+	TestEqual(TEXT("Zero weight is never sampled"), Frequencies[1], 0.0);
+	TestEqual(TEXT("Negative weight is never sampled"), Frequencies[5], 0.0);
+
+	// Without any positive weight every entry is equally likely.
+	const float ZeroWeights[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	Table.Build(ZeroWeights);
+
+	for (double Frequency : MeasureFrequencies(Table, SampleCount))
+	{
+		TestEqual(TEXT("Frequency without weights"), Frequency, 0.25, Tolerance);
+	}
+
+	// A single entry always wins, and an empty table has nothing to give.
+	const float SingleWeight[] = { 2.0f };
+	Table.Build(SingleWeight);
+	TestEqual(TEXT("Frequency of a single entry"), MeasureFrequencies(Table, 1000)[0], 1.0, 1e-9);
+
+	FRandomStream Stream(1);
+	Table.Build(TArrayView<const float>());
+	TestTrue(TEXT("Empty table is empty"), Table.IsEmpty());
+	TestEqual(TEXT("Sample of an empty table"), Table.Sample(Stream), (int32)INDEX_NONE);
+
+	return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,359 @@
+#include "Generator/DungeonLayout.h"
+#include "Generator/SyntheticTileset.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace DungeonLayoutTests
+{
+	/** Returns solve settings for the given seed, optionally with every kind of constraint. */
+	static FDungeonSolveParams MakeParams(int32 Seed, bool bBacktrack, bool bConstrained)
+	{
+		FDungeonSolveParams Params;
+		Params.Origin = FTransform(FRotator(0.0f, 30.0f, 0.0f), FVector(100.0f, -200.0f, 50.0f));
+		Params.GenerateLength = 16;
+		Params.Seed = Seed;
+		Params.bBacktrack = bBacktrack;
+
+		if (bConstrained)
+		{
+			Params.Constraints.TreasureCount = 2;
+			Params.Constraints.LockedPathIndices = { 9, 3 };
+			Params.Constraints.MinBranches = 4;
+		}
+
+		return Params;
+	}
+
+	/** Describes the first difference between the saved state of two layouts, or returns an empty string if they match. */
+	static FString FindDifference(const FDungeonLayout& A, const FDungeonLayout& B)
+	{
+		if (A.Rooms.Num() != B.Rooms.Num() || A.Doors.Num() != B.Doors.Num())
+		{
+			return FString::Printf(TEXT("%d rooms and %d doors against %d rooms and %d doors"), A.Rooms.Num(), A.Doors.Num(), B.Rooms.Num(), B.Doors.Num());
+		}
+
+		for (int32 RoomIndex = 0; RoomIndex < A.Rooms.Num(); RoomIndex++)
+		{
+			const FDungeonRoom& RoomA = A.Rooms[RoomIndex];
+			const FDungeonRoom& RoomB = B.Rooms[RoomIndex];
+
+			if (RoomA.TileIndex != RoomB.TileIndex || RoomA.GridCell != RoomB.GridCell || RoomA.Offset != RoomB.Offset
+				|| RoomA.Yaw != RoomB.Yaw || RoomA.PathIndex != RoomB.PathIndex || RoomA.SpawnSeed != RoomB.SpawnSeed
+				|| RoomA.Role != RoomB.Role || RoomA.LockIndex != RoomB.LockIndex)
+			{
+				return FString::Printf(TEXT("room %d"), RoomIndex);
+			}
+
+			if (A.Cells.FindRoom(RoomA.GridCell) != B.Cells.FindRoom(RoomB.GridCell))
+			{
+				return FString::Printf(TEXT("cell of room %d"), RoomIndex);
+			}
+		}
+
+		for (int32 DoorIndex = 0; DoorIndex < A.Doors.Num(); DoorIndex++)
+		{
+			const FDungeonDoor& DoorA = A.Doors[DoorIndex];
+			const FDungeonDoor& DoorB = B.Doors[DoorIndex];
+
+			if (DoorA.OwnerRoom != DoorB.OwnerRoom || DoorA.DoorFlag != DoorB.DoorFlag || DoorA.LeadsTo != DoorB.LeadsTo
+				|| DoorA.ExitOf != DoorB.ExitOf || DoorA.EntranceOf != DoorB.EntranceOf || DoorA.bSealed != DoorB.bSealed
+				|| DoorA.LockIndex != DoorB.LockIndex)
+			{
+				return FString::Printf(TEXT("door %d"), DoorIndex);
+			}
+		}
+
+		const FDungeonSolveStats& StatsA = A.Stats;
+		const FDungeonSolveStats& StatsB = B.Stats;
+
+		if (StatsA.GoldenLength != StatsB.GoldenLength || StatsA.TerminalCount != StatsB.TerminalCount
+			|| StatsA.SealedCount != StatsB.SealedCount || StatsA.KeyCount != StatsB.KeyCount
+			|| StatsA.TreasureCount != StatsB.TreasureCount || StatsA.bReachedLength != StatsB.bReachedLength
+			|| StatsA.bKeysSatisfied != StatsB.bKeysSatisfied || StatsA.bTreasureSatisfied != StatsB.bTreasureSatisfied
+			|| StatsA.bBranchesSatisfied != StatsB.bBranchesSatisfied)
+		{
+			return TEXT("stats");
+		}
+
+		if (A.SpawnSeed != B.SpawnSeed || A.Cells.Num() != B.Cells.Num() || !A.Origin.Equals(B.Origin))
+		{
+			return TEXT("spawn seed, cells or origin");
+		}
+
+		return FString();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDungeonLayoutSameSeedTest, "DescentCore.Generator.DungeonLayout.SameSeedSameLayout", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDungeonLayoutSameSeedTest::RunTest(const FString& Parameters)
+{
+	using namespace DungeonLayoutTests;
+
+	const FDungeonTileset Tileset = SyntheticTileset::Make(true);
+
+	// Reused layouts keep their capacity between solves, which must not leak into the result.
+	FDungeonLayout Reused;
+
+	for (int32 Variant = 0; Variant < 4; Variant++)
+	{
+		const bool bBacktrack = (Variant & 1) != 0;
+		const bool bConstrained = (Variant & 2) != 0;
+
+		for (int32 Seed = 0; Seed < 64; Seed++)
+		{
+			const FDungeonSolveParams Params = MakeParams(Seed, bBacktrack, bConstrained);
+
+			FDungeonLayout First;
+			FDungeonLayout Second;
+			TestTrue(TEXT("Solve succeeds"), First.Solve(Tileset, Params));
+			Second.Solve(Tileset, Params);
+
+			Reused.Solve(Tileset, MakeParams(Seed + 1000, !bBacktrack, !bConstrained));
+			Reused.Solve(Tileset, Params);
+
+			const FString Difference = FindDifference(First, Second);
+			const FString ReusedDifference = FindDifference(First, Reused);
+
+			if (!Difference.IsEmpty() || !ReusedDifference.IsEmpty())
+			{
+				AddError(FString::Printf(TEXT("Seed %d (backtrack %d, constrained %d) solved differently: %s%s"), Seed, bBacktrack, bConstrained, *Difference, *ReusedDifference));
+			}
+
+			// Counters that are not saved must match too.
+			TestEqual(TEXT("Door retries"), First.Stats.DoorRetries, Second.Stats.DoorRetries);
+			TestEqual(TEXT("Backtracks"), First.Stats.Backtracks, Second.Stats.Backtracks);
+			TestEqual(TEXT("Attempts"), First.Stats.Attempts, Second.Stats.Attempts);
+		}
+	}
+
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDungeonLayoutConstraintsTest, "DescentCore.Generator.DungeonLayout.ConstraintsSatisfied", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDungeonLayoutConstraintsTest::RunTest(const FString& Parameters)
+{
+	using namespace DungeonLayoutTests;
+
+	const FDungeonTileset Tileset = SyntheticTileset::Make(true);
+
+	for (int32 Seed = 0; Seed < 64; Seed++)
+	{
+		for (const bool bBacktrack : { false, true })
+		{
+			const FDungeonSolveParams Params = MakeParams(Seed, bBacktrack, true);
+			const FString Context = FString::Printf(TEXT("Seed %d (backtrack %d)"), Seed, bBacktrack);
+
+			FDungeonLayout Layout;
+
+			if (!Layout.Solve(Tileset, Params))
+			{
+				AddError(FString::Printf(TEXT("%s failed to solve"), *Context));
+				continue;
+			}
+
+			const FDungeonSolveStats& Stats = Layout.Stats;
+			TestTrue(FString::Printf(TEXT("%s satisfies its keys"), *Context), Stats.bKeysSatisfied);
+			TestEqual(FString::Printf(TEXT("%s key count"), *Context), Stats.KeyCount, Params.Constraints.LockedPathIndices.Num());
+			TestTrue(FString::Printf(TEXT("%s satisfies its treasure"), *Context), Stats.bTreasureSatisfied);
+			TestEqual(FString::Printf(TEXT("%s treasure count"), *Context), Stats.TreasureCount, Params.Constraints.TreasureCount);
+			TestTrue(FString::Printf(TEXT("%s satisfies its branches"), *Context), Stats.bBranchesSatisfied);
+			TestTrue(FString::Printf(TEXT("%s branch count"), *Context), Stats.TerminalCount >= Params.Constraints.MinBranches);
+
+			// Every held cell must have gone to a room by the end of the solve.
+			for (int32 RoomIndex = 0; RoomIndex < Layout.Rooms.Num(); RoomIndex++)
+			{
+				TestEqual(FString::Printf(TEXT("%s owner of room %d's cell"), *Context, RoomIndex), Layout.Cells.FindRoom(Layout.Rooms[RoomIndex].GridCell), RoomIndex);
+			}
+
+			// Each key sits before the door it opens.
+			for (const FDungeonRoom& Room : Layout.Rooms)
+			{
+				if (Room.Role == ERoomRole::Key)
+				{
+					const int32 LockedPathIndex = Params.Constraints.LockedPathIndices[Room.LockIndex];
+					TestTrue(FString::Printf(TEXT("%s key %d is reachable"), *Context, Room.LockIndex), Room.PathIndex <= LockedPathIndex);
+				}
+			}
+		}
+	}
+
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDungeonLayoutSaveLoadTest, "DescentCore.Generator.DungeonLayout.SaveLoadRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDungeonLayoutSaveLoadTest::RunTest(const FString& Parameters)
+{
+	using namespace DungeonLayoutTests;
+
+	const FDungeonTileset Tileset = SyntheticTileset::Make(true);
+
+	for (int32 Seed = 0; Seed < 64; Seed++)
+	{
+		FDungeonLayout Solved;
+		Solved.Solve(Tileset, MakeParams(Seed, (Seed & 1) != 0, (Seed & 2) != 0));
+
+		TArray<uint8> Data;
+		Solved.Save(Tileset, Data);
+
+		FDungeonLayout Loaded;
+
+		if (!Loaded.Load(Tileset, Data))
+		{
+			AddError(FString::Printf(TEXT("Seed %d failed to load"), Seed));
+			continue;
+		}
+
+		const FString Difference = FindDifference(Solved, Loaded);
+
+		if (!Difference.IsEmpty())
+		{
+			AddError(FString::Printf(TEXT("Seed %d loaded differently: %s"), Seed, *Difference));
+		}
+
+		TArray<uint8> Resaved;
+		Loaded.Save(Tileset, Resaved);
+		TestTrue(FString::Printf(TEXT("Seed %d saves the same after loading"), Seed), Resaved == Data);
+
+		// Any cut short must be rejected.
+		for (int32 Length = 0; Length < Data.Num(); Length += FMath::Max(Data.Num() / 16, 1))
+		{
+			TestFalse(FString::Printf(TEXT("Seed %d loads when truncated to %d bytes"), Seed, Length), Loaded.Load(Tileset, TConstArrayView<uint8>(Data.GetData(), Length)));
+		}
+	}
+
+	FDungeonLayout Solved;
+	Solved.Solve(Tileset, MakeParams(7, false, true));
+
+	TArray<uint8> Data;
+	Solved.Save(Tileset, Data);
+
+	FDungeonLayout Loaded;
+
+	// A different tileset can't rebuild the layout.
+	FDungeonTileset Changed = Tileset;
+	Changed.Tiles[1].Weight = 5.0f;
+	Changed.Build();
+	TestFalse(TEXT("Loads against a different tileset"), Loaded.Load(Changed, Data));
+
+	// Header: magic, version, tileset hash, origin, spawn seed and solve flags.
+	const int32 RotationOffset = sizeof(uint32) + sizeof(uint8) + sizeof(uint32) + sizeof(FVector);
+	const int32 CountsOffset = RotationOffset + sizeof(FQuat) + sizeof(FVector) + sizeof(uint32) + sizeof(uint8);
+
+	TArray<uint8> BadRotation = Data;
+	const FQuat Stretched(0.0, 0.0, 0.0, 2.0);
+	FMemory::Memcpy(BadRotation.GetData() + RotationOffset, &Stretched, sizeof(FQuat));
+	TestFalse(TEXT("Loads a non-unit rotation"), Loaded.Load(Tileset, BadRotation));
+
+	// Counts whose sum overflows an int32 must not get past the size check.
+	TArray<uint8> HugeCounts(Data.GetData(), CountsOffset);
+	HugeCounts.Append({ 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x01 });
+	HugeCounts.Append(Data.GetData() + CountsOffset, Data.Num() - CountsOffset);
+	TestFalse(TEXT("Loads overflowing room and door counts"), Loaded.Load(Tileset, HugeCounts));
+	TestEqual(TEXT("Rooms left after a failed load"), Loaded.Rooms.Num(), 0);
+
+	// A door with no room to own it.
+	TArray<uint8> OrphanDoor(Data.GetData(), CountsOffset);
+	OrphanDoor.Append({ 0x00, 0x01, 0x00, 0x00 });
+	TestFalse(TEXT("Loads a door without rooms"), Loaded.Load(Tileset, OrphanDoor));
+
+	// Two golden doors of the start room: the start, then two connectors
+	// entered from its northern and eastern doors. The path can't fork.
+	TArray<uint8> ForkedPath(Data.GetData(), CountsOffset);
+	ForkedPath.Append({ 0x03, 0x02, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x02 });
+	TestFalse(TEXT("Loads a forked golden path"), Loaded.Load(Tileset, ForkedPath));
+
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDungeonLayoutFootprintTest, "DescentCore.Generator.DungeonLayout.FootprintsNeverOverlap", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDungeonLayoutFootprintTest::RunTest(const FString& Parameters)
+{
+	using namespace DungeonLayoutTests;
+
+	const FDungeonTileset Tileset = SyntheticTileset::Make(true);
+	int32 MultiCellRooms = 0;
+
+	for (int32 Seed = 0; Seed < 64; Seed++)
+	{
+		FDungeonLayout Layout;
+		Layout.Solve(Tileset, MakeParams(Seed, (Seed & 1) != 0, (Seed & 2) != 0));
+
+		// Claiming every room's footprint again must never hit a taken cell.
+		FRoomCellGrid Grid;
+		int32 CellCount = 0;
+
+		for (int32 RoomIndex = 0; RoomIndex < Layout.Rooms.Num(); RoomIndex++)
+		{
+			const FDungeonRoom& Room = Layout.Rooms[RoomIndex];
+			const FDungeonTile& Tile = Tileset.Tiles[Room.TileIndex];
+			const FRoomFootprint Footprint = Tile.GetFootprint(Room.Yaw);
+
+			if (!Grid.TryOccupy(Room.GridCell, Footprint, RoomIndex))
+			{
+				AddError(FString::Printf(TEXT("Seed %d: room %d overlaps another room"), Seed, RoomIndex));
+			}
+
+			CellCount += (int32)FMath::CountBits(Footprint.Cells) * Footprint.Floors;
+			MultiCellRooms += Tile.FootprintSize > 1 ? 1 : 0;
+		}
+
+		// The solver's own grid holds exactly the rooms' cells, with nothing left reserved.
+		TestEqual(FString::Printf(TEXT("Seed %d cell count"), Seed), Layout.Cells.Num(), CellCount);
+	}
+
+	TestTrue(TEXT("Multi-cell rooms were placed"), MultiCellRooms > 0);
+
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDungeonLayoutBacktrackTest, "DescentCore.Generator.DungeonLayout.BacktrackingReachesLength", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FDungeonLayoutBacktrackTest::RunTest(const FString& Parameters)
+{
+	using namespace DungeonLayoutTests;
+
+	const FDungeonTileset Tileset = SyntheticTileset::Make(true);
+
+	for (const int32 Length : { 8, 32, 128 })
+	{
+		for (int32 Seed = 0; Seed < 32; Seed++)
+		{
+			FDungeonSolveParams Params = MakeParams(Seed, true, false);
+			Params.GenerateLength = Length;
+
+			FDungeonLayout Layout;
+			const FString Context = FString::Printf(TEXT("Seed %d at length %d"), Seed, Length);
+
+			if (!Layout.Solve(Tileset, Params))
+			{
+				AddError(FString::Printf(TEXT("%s failed to solve"), *Context));
+				continue;
+			}
+
+			TestTrue(FString::Printf(TEXT("%s reaches its length"), *Context), Layout.Stats.bReachedLength);
+			TestEqual(FString::Printf(TEXT("%s golden length"), *Context), Layout.Stats.GoldenLength, Length);
+
+			// The path runs from the start room through connectors to the boss.
+			if (Layout.Stats.GoldenLength == Length)
+			{
+				for (int32 PathIndex = 0; PathIndex < Length; PathIndex++)
+				{
+					const ERoomType Expected = PathIndex == 0 ? ERoomType::Start : PathIndex == Length - 1 ? ERoomType::Boss : ERoomType::Connector;
+					const FDungeonRoom& Room = Layout.Rooms[PathIndex];
+
+					TestTrue(FString::Printf(TEXT("%s room %d type"), *Context, PathIndex), Tileset.Tiles[Room.TileIndex].RoomType == Expected);
+					TestEqual(FString::Printf(TEXT("%s room %d path index"), *Context, PathIndex), Room.PathIndex, PathIndex);
+				}
+			}
+		}
+	}
+
+	return !HasAnyErrors();
+}
+
+#endif
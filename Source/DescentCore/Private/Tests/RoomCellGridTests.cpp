@@ -0,0 +1,102 @@
+#include "Generator/RoomCellGrid.h"
+#include "Generator/DungeonLayout.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace RoomCellGridTests
+{
+	/** Returns the footprint of a square room of the given size, optionally masked, turned by the given quarter turns. */
+	static FRoomFootprint MakeFootprint(int32 Size, uint64 Mask = 0, int32 Yaw = 0, int32 Floors = 1)
+	{
+		FDungeonTile Tile;
+		Tile.FootprintSize = Size;
+		Tile.FootprintMask = Mask;
+		Tile.FootprintFloors = Floors;
+		Tile.BuildFootprints();
+		return Tile.GetFootprint(Yaw);
+	}
+
+	/**
+	 * L-shaped 3x3 footprint: the southern row and western column. Bit
+	 * X + 3 * Y is the cell X north and Y east of the south-west corner.
+	 */
+	static constexpr uint64 LShapeMask = (1 << 0) | (1 << 1) | (1 << 2) | (1 << 3) | (1 << 6);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRoomCellGridFootprintTest, "DescentCore.Generator.RoomCellGrid.FootprintOverlaps", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FRoomCellGridFootprintTest::RunTest(const FString& Parameters)
+{
+	using namespace RoomCellGridTests;
+
+	const FRoomFootprint Single = MakeFootprint(1);
+	const FRoomFootprint Square = MakeFootprint(3);
+
+	// Squares overlap whenever their centers are less than three cells apart.
+	{
+		FRoomCellGrid Grid;
+		TestTrue(TEXT("Place square"), Grid.TryOccupy(FIntVector(0, 0, 0), Square, 0));
+		TestEqual(TEXT("Square cell count"), Grid.Num(), 9);
+		TestEqual(TEXT("Corner belongs to the square"), Grid.FindRoom(FIntVector(1, -1, 0)), 0);
+		TestTrue(TEXT("Diagonal square overlaps"), Grid.Overlaps(FIntVector(2, 2, 0), Square));
+		TestFalse(TEXT("Adjacent square overlaps"), Grid.Overlaps(FIntVector(3, 0, 0), Square));
+		TestFalse(TEXT("Single cell past the corner overlaps"), Grid.Overlaps(FIntVector(2, 2, 0), Single));
+
+		// A failed placement leaves the grid as it was.
+		TestFalse(TEXT("Place overlapping square"), Grid.TryOccupy(FIntVector(1, 1, 0), Square, 1));
+		TestEqual(TEXT("Cell count after failed placement"), Grid.Num(), 9);
+		TestEqual(TEXT("Overlapped cell keeps its room"), Grid.FindRoom(FIntVector(1, 1, 0)), 0);
+
+		Grid.Release(FIntVector(0, 0, 0), Square);
+		TestEqual(TEXT("Cell count after release"), Grid.Num(), 0);
+		TestFalse(TEXT("Released square overlaps"), Grid.Overlaps(FIntVector(1, 1, 0), Square));
+	}
+
+	// Footprints straddling the edges of the 8x8 occupancy blocks, on both sides of zero.
+	{
+		FRoomCellGrid Grid;
+		TestTrue(TEXT("Place square across positive blocks"), Grid.TryOccupy(FIntVector(7, 7, 0), Square, 0));
+		TestTrue(TEXT("Place square across negative blocks"), Grid.TryOccupy(FIntVector(-1, -1, 0), Square, 1));
+		TestTrue(TEXT("Overlap across positive blocks"), Grid.Overlaps(FIntVector(9, 9, 0), Square));
+		TestFalse(TEXT("Clear across positive blocks"), Grid.Overlaps(FIntVector(10, 10, 0), Square));
+		TestTrue(TEXT("Overlap across negative blocks"), Grid.Overlaps(FIntVector(1, 1, 0), Square));
+		TestFalse(TEXT("Clear across negative blocks"), Grid.Overlaps(FIntVector(2, 2, 0), Square));
+		TestFalse(TEXT("Clear on another floor"), Grid.Overlaps(FIntVector(7, 7, 1), Square));
+	}
+
+	// Turned L shapes cover turned cells, and can interlock where squares can't.
+	{
+		const FRoomFootprint LShape = MakeFootprint(3, LShapeMask, 0);
+		const FRoomFootprint LShapeTurned = MakeFootprint(3, LShapeMask, 1);
+		const FRoomFootprint LShapeReversed = MakeFootprint(3, LShapeMask, 2);
+
+		FRoomCellGrid Grid;
+		TestTrue(TEXT("Place turned L"), Grid.TryOccupy(FIntVector(0, 0, 0), LShapeTurned, 0));
+		TestEqual(TEXT("L cell count"), Grid.Num(), 6);
+		TestTrue(TEXT("Turned L covers its turned corner"), Grid.IsOccupied(FIntVector(1, 1, 0)));
+		TestFalse(TEXT("Turned L leaves its open corner"), Grid.IsOccupied(FIntVector(-1, 1, 0)));
+		TestFalse(TEXT("Turned L leaves its open side"), Grid.IsOccupied(FIntVector(-1, 0, 0)));
+
+		Grid.Reset();
+		TestTrue(TEXT("Place L"), Grid.TryOccupy(FIntVector(0, 0, 0), LShape, 0));
+		TestFalse(TEXT("Reversed L interlocks"), Grid.Overlaps(FIntVector(1, 1, 0), LShapeReversed));
+		TestTrue(TEXT("Unturned L overlaps"), Grid.Overlaps(FIntVector(1, 1, 0), LShape));
+		TestTrue(TEXT("Square overlaps"), Grid.Overlaps(FIntVector(1, 1, 0), Square));
+		TestTrue(TEXT("Place reversed L"), Grid.TryOccupy(FIntVector(1, 1, 0), LShapeReversed, 1));
+		TestEqual(TEXT("Interlocked cell count"), Grid.Num(), 12);
+	}
+
+	// Rooms spanning floors claim every floor above their center.
+	{
+		FRoomCellGrid Grid;
+		TestTrue(TEXT("Place tall room"), Grid.TryOccupy(FIntVector(20, 0, 0), MakeFootprint(1, 0, 0, 2), 0));
+		TestTrue(TEXT("Upper floor is taken"), Grid.IsOccupied(FIntVector(20, 0, 1)));
+		TestFalse(TEXT("Floor above is free"), Grid.IsOccupied(FIntVector(20, 0, 2)));
+		TestTrue(TEXT("Room on the upper floor overlaps"), Grid.Overlaps(FIntVector(20, 0, 1), Single));
+	}
+
+	return !HasAnyErrors();
+}
+
+#endif
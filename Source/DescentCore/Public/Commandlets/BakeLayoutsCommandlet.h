@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BakeLayoutsCommandlet.generated.h"
+
+/**
+ * Pre-bakes the layout cache for every generator placed in a map. Baked
+ * layouts are written under Content/LayoutCache, to be staged with the game.
+ *
+ * Usage: -run=BakeLayouts -Map=/Game/Maps/Dungeon [-Seeds=0-255|1,5,9]
+ */
+UCLASS()
+class DESCENTCORE_API UBakeLayoutsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Constructs the Commandlet. */
+	UBakeLayoutsCommandlet();
+
+	/** Bakes the layouts. Returns zero on success. */
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "GeneratorBenchmarkCommandlet.generated.h"
+
+/**
+ * Headless benchmark for the layout solver. Solves a synthetic tileset over
+ * a range of seeds and golden path lengths, then reports timing and quality
+ * figures per length as CSV or JSON. With -Parallel, each length is also
+ * solved as one parallel batch to measure throughput. Allocations are
+ * counted on the game thread during the sequential solves only.
+ *
+ * Usage: -run=GeneratorBenchmark -nullrhi [-Seeds=1000] [-Lengths=8,32,128,500] [-Format=csv|json] [-Output=Path] [-Backtrack] [-BacktrackSteps=65536] [-Parallel]
+ */
+UCLASS()
+class DESCENTCORE_API UGeneratorBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Constructs the Commandlet. */
+	UGeneratorBenchmarkCommandlet();
+
+	/** Runs the benchmark. Returns zero on success. */
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Walker/Vose alias table for constant-time weighted sampling.
+ * Built once from a set of weights, then sampled with two random draws.
+ */
+struct DESCENTCORE_API FAliasTable
+{
+public:
+
+	/**
+	 * Rebuilds the table from the given weights. Negative weights are treated
+	 * as zero, and a set with no positive weight is sampled uniformly.
+	 *
+	 * @param Weights Relative weight of each entry.
+	 */
+	void Build(TArrayView<const float> Weights);
+
+	/** Returns a weighted random entry index, or INDEX_NONE if the table is empty. */
+	int32 Sample(FRandomStream& Stream) const;
+
+	/** Returns the number of entries in the table. */
+	int32 Num() const
+	{
+		return Probability.Num();
+	}
+
+	/** Checks whether the table has no entries. */
+	bool IsEmpty() const
+	{
+		return Probability.IsEmpty();
+	}
+
+private:
+
+	/** Chance of keeping each column's own entry instead of its alias. */
+	TArray<float> Probability;
+
+	/** Entry returned when a column's own entry is rejected. */
+	TArray<int32> Alias;
+};
@@ -0,0 +1,439 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Generator/AliasTable.h"
+#include "Generator/RoomCellGrid.h"
+#include "Generator/RoomData.h"
+#include "Misc/MemStack.h"
+
+/** Plain copy of the URoomData fields the layout solver needs. */
+struct DESCENTCORE_API FDungeonTile
+{
+	/** The tile's function in the tileset. */
+	ERoomType RoomType = ERoomType::Connector;
+
+	/** The tile's doors in its default rotation, as ERoomDoorFlags. */
+	int32 DoorFlags = 0;
+
+	/** Relative chance of this tile being picked over others of the same type. */
+	float Weight = 1.0f;
+
+	/** Room width and depth measured in meters. */
+	int32 RoomSize = 20;
+
+	/** Room height measured in meters. */
+	int32 RoomHeight = 12;
+
+	/** Grid cells along each side of the room's footprint. Odd, so the room centers on a cell. */
+	int32 FootprintSize = 1;
+
+	/**
+	 * Covered cells of the footprint square, bit X + FootprintSize * Y from the south-west corner. Zero covers all.
+	 * The center cell and the middle cell of the southern edge and of each door's edge are always covered.
+	 */
+	uint64 FootprintMask = 0;
+
+	/** Grid floors the room spans. Upper doors lead out above the topmost. */
+	int32 FootprintFloors = 1;
+
+	/** Footprint bitboards for each quarter turn, filled in by BuildFootprints. */
+	uint64 Footprints[4] = { FRoomFootprint::CenterCell, FRoomFootprint::CenterCell, FRoomFootprint::CenterCell, FRoomFootprint::CenterCell };
+
+	/** Turns the footprint settings into a bitboard for each quarter turn. */
+	void BuildFootprints();
+
+	/** Returns the cells the room covers when turned by the given quarter turns. */
+	FRoomFootprint GetFootprint(int32 Yaw) const
+	{
+		return FRoomFootprint { Footprints[Yaw & 3], FootprintFloors };
+	}
+
+	/** Returns the number of cells between the room's center cell and its edge. */
+	int32 GetFootprintRadius() const
+	{
+		return FootprintSize / 2;
+	}
+
+	/**
+	 * Calculates the world position and direction of a door for the given room transform.
+	 *
+	 * @param RoomTransform Transform of the room from which to build a door.
+	 * @param DoorType Door to build, if available.
+	 * @param OutPoint Returned global door position.
+	 * @param OutDirection Returned global door direction.
+	 * @return Whether the door type is valid for the tile.
+	 */
+	bool GetConnectionVectorsFor(const FTransform& RoomTransform, ERoomDoorFlags DoorType, FVector& OutPoint, FVector& OutDirection) const;
+
+	/** Returns the room transform needed to connect with the given entrance point and direction. */
+	FTransform GetConnectionTransformFrom(const FVector& EntryPoint, const FVector& EntryDirection) const;
+};
+
+/** Set of tiles bucketed by room type for constant-time weighted picks. */
+struct DESCENTCORE_API FDungeonTileset
+{
+public:
+
+	/** Every tile in the set. Solved rooms refer to tiles by index into this array. */
+	TArray<FDungeonTile> Tiles;
+
+	/** Sorts the tiles into per-type buckets and builds their footprints. Must be called after Tiles changes. */
+	void Build();
+
+	/** Returns the index of a weighted random tile with the given type, or INDEX_NONE if there is none. */
+	int32 GetRandomTile(ERoomType RoomType, FRandomStream& Stream) const;
+
+	/** Returns a hash of every tile's solver data. Layouts only load against a tileset with the same hash. */
+	uint32 GetContentHash() const;
+
+	/** Returns the most doors any tile has. Bounds how many rooms a golden path room can lead to. */
+	int32 GetMaxDoorCount() const
+	{
+		return MaxDoorCount;
+	}
+
+private:
+
+	/** Most doors on any tile, found by Build. */
+	int32 MaxDoorCount = 0;
+
+	/** Tile indices of each room type. */
+	TArray<int32> Buckets[(int32)ERoomType::Boss + 1];
+
+	/** Alias tables built from the tile weights of each bucket. */
+	FAliasTable Samplers[(int32)ERoomType::Boss + 1];
+};
+
+/** Designer requirements the solver places rooms around. */
+struct DESCENTCORE_API FDungeonConstraints
+{
+	/** Terminals to mark as treasure rooms. */
+	int32 TreasureCount = 0;
+
+	/**
+	 * Golden path rooms, by PathIndex, whose exit door is locked, in any
+	 * order. Each lock gets a key terminal branching off the path after the
+	 * previous lock and no later than its own room. Entries without an exit
+	 * on the golden path, and repeats, are rejected with an error.
+	 */
+	TArray<int32> LockedPathIndices;
+
+	/** Fewest terminals that must branch off the golden path. Space for them is held while the path is built. */
+	int32 MinBranches = 0;
+
+	/** Layouts tried, each with a seed derived from the first, before settling for the closest one. */
+	int32 MaxAttempts = 8;
+
+	/** Checks whether there is nothing to enforce. */
+	bool IsEmpty() const
+	{
+		return TreasureCount <= 0 && LockedPathIndices.IsEmpty() && MinBranches <= 0;
+	}
+
+	/** Returns a hash of the requirements, or zero if there are none. */
+	uint32 GetHash() const;
+};
+
+/** Settings for a single layout solve. */
+struct FDungeonSolveParams
+{
+	/** Transform of the start room. */
+	FTransform Origin = FTransform::Identity;
+
+	/** Length of the golden path, including the start and boss rooms. */
+	int32 GenerateLength = 8;
+
+	/** Seed for every random selection made during the solve. */
+	int32 Seed = 0;
+
+	/** Undo rooms at dead ends instead of cutting the golden path short. */
+	bool bBacktrack = false;
+
+	/**
+	 * Search steps a backtracking golden path solve may take before keeping
+	 * the path found so far. Counted in steps rather than time so that a
+	 * seed solves the same way on every machine.
+	 */
+	int32 MaxBacktrackSteps = 65536;
+
+	/** Requirements enforced while placing rooms. */
+	FDungeonConstraints Constraints;
+};
+
+/** A room placed by the layout solver. */
+struct FDungeonRoom
+{
+	/** Index of the room's tile in the solved tileset. */
+	int32 TileIndex = INDEX_NONE;
+
+	/** Integer grid cell the room occupies. */
+	FIntVector GridCell = FIntVector::ZeroValue;
+
+	/** Position of the room's center in centimeters, relative to the start room and in its rotation. */
+	FIntVector Offset = FIntVector::ZeroValue;
+
+	/** Quarter turns of the room relative to the start room, clockwise seen from above. */
+	uint8 Yaw = 0;
+
+	/** Index in the golden path. Terminals use their associated Connector. */
+	int32 PathIndex = 0;
+
+	/** Seed for the room manager's spawn stream. */
+	int32 SpawnSeed = 0;
+
+	/** What the room was picked to hold. */
+	ERoomRole Role = ERoomRole::None;
+
+	/** For key rooms, the index of the lock their key opens. */
+	int32 LockIndex = INDEX_NONE;
+};
+
+/** An open or sealed doorway placed by the layout solver. */
+struct FDungeonDoor
+{
+	/** Room whose doorway this is. Unlike ExitOf, also set for sealed doorways. */
+	int32 OwnerRoom = INDEX_NONE;
+
+	/** Which of the owner's doors this is, as a single ERoomDoorFlags bit. */
+	int32 DoorFlag = 0;
+
+	/** Room placed behind this doorway, or INDEX_NONE. */
+	int32 LeadsTo = INDEX_NONE;
+
+	/** Room this door is an exit of, or INDEX_NONE. */
+	int32 ExitOf = INDEX_NONE;
+
+	/** Golden path room this door is the entrance of, or INDEX_NONE. */
+	int32 EntranceOf = INDEX_NONE;
+
+	/** Whether the doorway is sealed instead of connecting two rooms. */
+	bool bSealed = false;
+
+	/** For locked golden path doors, the index of their lock in the solve's constraints. */
+	int32 LockIndex = INDEX_NONE;
+};
+
+/** Counters describing how a single solve went. */
+struct FDungeonSolveStats
+{
+	/** Wall time spent in Solve. */
+	double SolveSeconds = 0.0;
+
+	/** Door picks rejected because they led into an occupied cell. */
+	int32 DoorRetries = 0;
+
+	/** Golden path rooms removed at dead ends by a backtracking solve. */
+	int32 Backtracks = 0;
+
+	/** Number of rooms placed on the golden path. */
+	int32 GoldenLength = 0;
+
+	/** Number of terminals placed by the backfill pass. */
+	int32 TerminalCount = 0;
+
+	/** Number of doorways sealed by the backfill pass. */
+	int32 SealedCount = 0;
+
+	/** Number of terminals holding a key. */
+	int32 KeyCount = 0;
+
+	/** Number of terminals holding treasure. */
+	int32 TreasureCount = 0;
+
+	/** Layouts tried before this one was kept. Not kept by saved layouts. */
+	int32 Attempts = 0;
+
+	/** Whether the golden path reached the requested length. */
+	bool bReachedLength = false;
+
+	/** Whether every locked door has a key before it. */
+	bool bKeysSatisfied = true;
+
+	/** Whether the requested number of treasure terminals was placed. */
+	bool bTreasureSatisfied = true;
+
+	/** Whether at least the requested number of terminals branch off the golden path. */
+	bool bBranchesSatisfied = true;
+
+	/** Returns the number of constraints met, out of three. */
+	int32 GetSatisfiedCount() const
+	{
+		return (bKeysSatisfied ? 1 : 0) + (bTreasureSatisfied ? 1 : 0) + (bBranchesSatisfied ? 1 : 0);
+	}
+};
+
+/**
+ * UObject-free level layout. Solving turns a tileset and a seed into plain
+ * arrays of rooms and doors, so it can run on any thread.
+ */
+struct DESCENTCORE_API FDungeonLayout
+{
+public:
+
+	/** Rooms in placement order; golden path first. */
+	TArray<FDungeonRoom> Rooms;
+
+	/** Open and sealed doorways. */
+	TArray<FDungeonDoor> Doors;
+
+	/** Maps occupied grid cells to indices into Rooms. */
+	FRoomCellGrid Cells;
+
+	/** Counters from the last solve. Timings and retries are not kept by saved layouts. */
+	FDungeonSolveStats Stats;
+
+	/** Seed every room's spawn seed is derived from. */
+	uint32 SpawnSeed = 0;
+
+	/** Transform of the start room. Every other room is placed relative to it. */
+	FTransform Origin = FTransform::Identity;
+
+	/** Clears the layout, reserving space for the given number of rooms. */
+	void Reset(int32 ExpectedRooms = 0);
+
+	/** Builds the world transform of the given room. */
+	FTransform GetRoomTransform(int32 RoomIndex) const;
+
+	/**
+	 * Builds the world transform of the given doorway, facing out of its owner room.
+	 *
+	 * @param Tileset Tileset the layout was solved with.
+	 * @param DoorIndex Index into Doors.
+	 */
+	FTransform GetDoorTransform(const FDungeonTileset& Tileset, int32 DoorIndex) const;
+
+	/**
+	 * Builds a golden path from a start room to a boss room and backfills
+	 * its spare doors with terminals or seals. Space for the constraints'
+	 * branches is held while the path is built, key terminals are placed
+	 * before any other, and layouts falling short of the constraints'
+	 * counts are retried with derived seeds up to MaxAttempts. The same
+	 * tileset and params always produce the same layout.
+	 *
+	 * @param Tileset Built tileset to pick rooms from.
+	 * @param Params Origin, length and seed of the solve.
+	 * @return False if the tileset has no start room.
+	 */
+	bool Solve(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params);
+
+	/**
+	 * Solves one layout per entry of the given params on worker threads. Each
+	 * solve writes only to its own layout, and the tileset is only read.
+	 *
+	 * @param Tileset Built tileset to pick rooms from.
+	 * @param Params Origin, length and seed of each solve.
+	 * @param OutLayouts Returned layouts, matching Params by index.
+	 */
+	static void SolveBatch(const FDungeonTileset& Tileset, TConstArrayView<FDungeonSolveParams> Params, TArray<FDungeonLayout>& OutLayouts);
+
+	/**
+	 * Writes the layout in a compact binary format. Only tile indices and the
+	 * doors each room was reached through are stored; offsets, cells and
+	 * path indices are rebuilt from the tileset on load.
+	 *
+	 * @param Tileset Tileset the layout was solved with.
+	 * @param OutData Returned layout data, replacing any previous contents.
+	 */
+	void Save(const FDungeonTileset& Tileset, TArray<uint8>& OutData) const;
+
+	/**
+	 * Rebuilds a layout written by Save without solving. Reads straight from
+	 * the given memory.
+	 *
+	 * @param Tileset Tileset the layout was solved with.
+	 * @param Data Layout data written by Save.
+	 * @return False if the data is malformed or was saved against a different tileset.
+	 */
+	bool Load(const FDungeonTileset& Tileset, TConstArrayView<uint8> Data);
+
+private:
+
+	/** Per-room door masks of a solve in progress. Lives on the solving thread's memory stack. */
+	using FDoorMaskArray = TArray<int32, TMemStackAllocator<>>;
+
+	/** A validated lock of the constraints. */
+	struct FLockRequest
+	{
+		/** Golden path room whose exit is locked. */
+		int32 PathIndex = INDEX_NONE;
+
+		/** Index of the lock in the constraints' LockedPathIndices. */
+		int32 LockIndex = INDEX_NONE;
+	};
+
+	/** Validated locks, in path order. */
+	using FLockArray = TArray<FLockRequest, TInlineAllocator<8>>;
+
+	/** Cells held behind a spare golden path door for a branch, while the rest of the path is built. */
+	struct FBranchReservation
+	{
+		/** Golden path room the branch leaves from. */
+		int32 RoomIndex = INDEX_NONE;
+
+		/** Spare door of the room the branch goes through. */
+		int32 DoorFlag = 0;
+
+		/** Terminal tile the cells were held for. */
+		int32 TileIndex = INDEX_NONE;
+
+		/** Cell the terminal is centered on. */
+		FIntVector Center = FIntVector::ZeroValue;
+
+		/** Cells held for the terminal. */
+		FRoomFootprint Footprint;
+	};
+
+	/** Branch reservations of a solve in progress, in golden path order. Lives on the solving thread's memory stack. */
+	using FBranchArray = TArray<FBranchReservation, TMemStackAllocator<>>;
+
+	/** Validates and sorts the locks of the given params, logging and dropping bad entries. */
+	static void GatherLocks(const FDungeonSolveParams& Params, FLockArray& OutLocks);
+
+	/** Appends a golden path room at the given placement, occupies its cells and hooks up its entrance. Returns its index. */
+	int32 AddGoldenRoom(const FDungeonTileset& Tileset, int32 TileIndex, const FDungeonRoom& Placement, int32 EntranceDoor);
+
+	/** Walks the golden path one random door at a time, stopping at the first dead end. */
+	void SolveGreedyPath(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params, int32 StartTile, FRandomStream& Stream, FDoorMaskArray& OutEmptyDoors, FBranchArray& OutBranches);
+
+	/** Searches for a full-length golden path, undoing rooms at dead ends until the step budget runs out. */
+	void SolveBacktrackingPath(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params, int32 StartTile, FRandomStream& Stream, FDoorMaskArray& OutEmptyDoors, FBranchArray& OutBranches);
+
+	/** Solves a single attempt with the given seed. Returns false if the tileset has no start room. */
+	bool SolveAttempt(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params, const FLockArray& Locks, int32 AttemptSeed);
+
+	/**
+	 * Holds cells for terminals behind the spare doors of a golden path room
+	 * that has been left, until enough are held for the constraints'
+	 * MinBranches. Draws nothing once enough are held.
+	 *
+	 * @param RoomIndex Golden path room that was just left.
+	 * @param SpareDoors Doors of the room not used by the path.
+	 */
+	void ReserveBranches(const FDungeonTileset& Tileset, const FDungeonSolveParams& Params, FRandomStream& Stream, int32 RoomIndex, int32 SpareDoors, FBranchArray& Branches);
+
+	/** Frees the cells of every reservation from the given index on, keeping the reservations. */
+	void FreeBranchCells(const FBranchArray& Branches, int32 FirstBranch);
+
+	/** Frees the cells of every reservation from the given index on, and removes them. */
+	void ReleaseBranches(FBranchArray& Branches, int32 FirstBranch);
+
+	/** Places a key terminal for each lock, taking the doors it uses out of the spare doors. */
+	void PlaceKeys(const FDungeonTileset& Tileset, const FLockArray& Locks, FRandomStream& Stream, FDoorMaskArray& GoldenEmptyDoors);
+
+	/** Places the reserved branch terminals whose doors are still spare, taking those doors out of the spare doors. */
+	void PlaceBranches(const FDungeonTileset& Tileset, FRandomStream& Stream, const FBranchArray& Branches, FDoorMaskArray& GoldenEmptyDoors);
+
+	/** Marks random terminals without a role as treasure rooms. */
+	void PlaceTreasure(const FDungeonConstraints& Constraints, FRandomStream& Stream);
+
+	/**
+	 * Places a terminal behind the given spare door of a golden path room.
+	 *
+	 * @param TerminalTile Tile of the terminal, or INDEX_NONE to draw a random one.
+	 * @return Index of the terminal, or INDEX_NONE if none fits.
+	 */
+	int32 TryPlaceTerminal(const FDungeonTileset& Tileset, FRandomStream& Stream, int32 RoomIndex, int32 DoorFlag, int32 TerminalTile = INDEX_NONE);
+
+	/** Fills the spare doors of each golden path room with terminals or seals. */
+	void BackfillPath(const FDungeonTileset& Tileset, FRandomStream& Stream, const FDoorMaskArray& GoldenEmptyDoors);
+};
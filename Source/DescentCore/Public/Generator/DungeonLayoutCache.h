@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Everything a solved layout depends on. */
+struct DESCENTCORE_API FDungeonLayoutCacheKey
+{
+	/** Content hash of the tileset, including its room assets. */
+	uint32 TilesetHash = 0;
+
+	/** Hash of the start room transform. */
+	uint32 OriginHash = 0;
+
+	/** Seed of the solve. */
+	int32 Seed = 0;
+
+	/** Length of the golden path. */
+	int32 GenerateLength = 0;
+
+	/** Whether the golden path was solved with backtracking. */
+	bool bBacktrack = false;
+
+	/** Step budget of a backtracking solve. Ignored unless bBacktrack is set. */
+	int32 MaxBacktrackSteps = 0;
+
+	/** Hash of the solve constraints, or zero if there are none. */
+	uint32 ConstraintHash = 0;
+
+	/** Returns the file name the layout is cached under. */
+	FString GetFileName() const;
+};
+
+/**
+ * On-disk cache of saved layouts. Layouts baked at cook time live under
+ * Content/LayoutCache and must be staged as non-asset files; layouts solved
+ * at runtime are written under Saved/LayoutCache.
+ */
+struct DESCENTCORE_API FDungeonLayoutCache
+{
+public:
+
+	/** Returns the directory baked layouts are read from and written to. */
+	static FString GetBakedDirectory();
+
+	/** Returns the directory runtime layouts are read from and written to. */
+	static FString GetSavedDirectory();
+
+	/**
+	 * Looks for a cached layout, baked layouts first.
+	 *
+	 * @param Key Solve the layout belongs to.
+	 * @param OutData Returned layout data, as written by FDungeonLayout::Save.
+	 * @return Whether a cached layout was found.
+	 */
+	static bool Find(const FDungeonLayoutCacheKey& Key, TArray<uint8>& OutData);
+
+	/**
+	 * Writes a layout to the cache.
+	 *
+	 * @param Key Solve the layout belongs to.
+	 * @param Data Layout data written by FDungeonLayout::Save.
+	 * @param bBaked Whether to write into the baked directory instead of the saved one.
+	 * @return Whether the file was written.
+	 */
+	static bool Store(const FDungeonLayoutCacheKey& Key, const TArray<uint8>& Data, bool bBaked = false);
+};
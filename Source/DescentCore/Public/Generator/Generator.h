@@ -2,12 +2,129 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Generator/DungeonLayout.h"
+#include "Generator/DungeonLayoutCache.h"
+#include "Generator/RoomCellGrid.h"
 #include "Generator/RoomData.h"
+#include "Tasks/Task.h"
+#include "UObject/SoftObjectPath.h"
 #include "Generator.generated.h"
 
+class APawn;
 class ARoomDoor;
 class ARoomManager;
+class UHierarchicalInstancedStaticMeshComponent;
 class ULevelStreamingDynamic;
+class UStaticMesh;
+struct FStreamableHandle;
+
+/** Level instance of a single generated room. */
+struct FGeneratedRoomLevel
+{
+	/** Streaming level of the room, or null if it has never been requested. */
+	ULevelStreamingDynamic* Level = nullptr;
+
+	/** Index of the room's tile in the generator's solver tileset. */
+	int32 TileIndex = INDEX_NONE;
+
+	/** Index in the golden path. Terminals use their associated Connector. */
+	int32 PathIndex = 0;
+
+	/** World transform of the room instance. */
+	FTransform Transform;
+
+	/** Whether the room's level is meant to be shown. */
+	bool bVisible = false;
+};
+
+/** An open doorway drawn as an instance until its room needs a door actor. */
+struct FGeneratedDoorway
+{
+	/** World transform of the doorway. */
+	FTransform Transform;
+
+	/** Door actor spawned for the doorway, if any. */
+	ARoomDoor* Actor = nullptr;
+};
+
+/** Requirements the layout solver places rooms around. */
+USTRUCT(BlueprintType)
+struct DESCENTCORE_API FGenerationConstraints
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Terminals to mark as treasure rooms. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 0))
+	int32 TreasureCount = 0;
+
+	/**
+	 * Golden path rooms, by PathIndex, whose exit door is locked, in any
+	 * order. Each lock gets a key terminal branching off the path after the
+	 * previous lock and no later than its own room. Locks are only placed
+	 * with a key. Rooms without an exit on the golden path, and repeats, are
+	 * rejected with an error.
+	 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<int32> LockedPathIndices;
+
+	/** Fewest terminals that must branch off the golden path. Space for them is held while the path is built. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 0))
+	int32 MinBranches = 0;
+
+	/** Layouts tried, each from a seed derived from the generator's, before settling for the closest one. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 1))
+	int32 MaxAttempts = 8;
+};
+
+/** Which constraints the last solve met, and what it cost. */
+USTRUCT(BlueprintType)
+struct DESCENTCORE_API FGenerationReport
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Whether every locked door has a key before it. */
+	UPROPERTY(BlueprintReadOnly)
+	bool bKeysSatisfied = true;
+
+	/** Whether the requested number of treasure terminals was placed. */
+	UPROPERTY(BlueprintReadOnly)
+	bool bTreasureSatisfied = true;
+
+	/** Whether enough terminals branch off the golden path. */
+	UPROPERTY(BlueprintReadOnly)
+	bool bBranchesSatisfied = true;
+
+	/** Whether the golden path reached GenerateLength. */
+	UPROPERTY(BlueprintReadOnly)
+	bool bReachedLength = false;
+
+	/** Number of key terminals placed. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 KeyCount = 0;
+
+	/** Number of treasure terminals placed. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 TreasureCount = 0;
+
+	/** Number of terminals branching off the golden path. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 BranchCount = 0;
+
+	/** Layouts tried by the solve. Zero if the level was loaded instead of solved. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Attempts = 0;
+
+	/** Wall time of the solve, every attempt included. */
+	UPROPERTY(BlueprintReadOnly, meta = (Units = "ms"))
+	float SolveMilliseconds = 0.0f;
+};
+
+/** Invoked once a generated level has finished spawning. */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnLevelGenerated);
 
 /** Actor responsible for building a golden path and branches. */
 UCLASS()
@@ -33,14 +150,100 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category = "Generation", EditAnywhere)
 	TSubclassOf<ARoomDoor> SealClass;
 
+	/** Mesh drawn in sealed doorways. When set, seals are instances on the generator instead of SealClass actors. */
+	UPROPERTY(BlueprintReadOnly, Category = "Generation", EditAnywhere)
+	UStaticMesh* SealMesh = nullptr;
+
+	/**
+	 * Mesh drawn in open doorways. When set, open doors are instances on the
+	 * generator until their room locks or unlocks, and only then become
+	 * DoorClass actors.
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Generation", EditAnywhere)
+	UStaticMesh* DoorMesh = nullptr;
+
 	/** Length of the generated golden level path. */
 	UPROPERTY(BlueprintReadOnly, Category = "Generation", EditAnywhere)
 	int32 GenerateLength = 8;
 
+	/** Seed for every random selection made during generation. The same seed always builds the same level. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation", EditAnywhere)
+	int32 Seed = 0;
+
+	/** Undo rooms at dead ends so the golden path always reaches GenerateLength when the tileset allows it. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation", EditAnywhere)
+	bool bBacktrackGoldenPath = false;
+
+	/**
+	 * Search steps a backtracking golden path solve may take. The path found
+	 * so far is kept when they run out. A step budget rather than a time
+	 * budget keeps every seed solving to the same level on every machine.
+	 */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation", EditAnywhere, meta = (ClampMin = 1, EditCondition = "bBacktrackGoldenPath"))
+	int32 MaxBacktrackSteps = 65536;
+
+	/** Treasure, key and branch requirements enforced while the layout is solved. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Constraints", EditAnywhere)
+	FGenerationConstraints Constraints;
+
+	/** Load solved layouts from the on-disk layout cache, and store new solves in it. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation", EditAnywhere)
+	bool bUseLayoutCache = false;
+
+	/** Solve the layout on a worker thread and spread spawning over several frames. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Async", EditAnywhere)
+	bool bGenerateAsync = false;
+
+	/** Game thread time spent spawning rooms and doors per frame while generating asynchronously. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Async", EditAnywhere, meta = (ClampMin = 0.1, Units = "ms"))
+	float SpawnBudgetMilliseconds = 2.0f;
+
+	/** Keep only rooms near the players loaded instead of every room of the level. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Streaming", EditAnywhere)
+	bool bStreamRooms = false;
+
+	/** Rooms within this many golden path steps of a player are loaded and visible. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Streaming", EditAnywhere, meta = (ClampMin = 0, EditCondition = "bStreamRooms"))
+	int32 StreamingDistance = 2;
+
+	/** Rooms up to this many steps past the visible ones, ahead of a player, are loaded hidden. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Streaming", EditAnywhere, meta = (ClampMin = 0, EditCondition = "bStreamRooms"))
+	int32 PrefetchDistance = 2;
+
+	/** Total estimated memory of loaded rooms. Farther rooms are dropped first. Zero disables the budget. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Streaming", EditAnywhere, meta = (ClampMin = 0, Units = "MB", EditCondition = "bStreamRooms"))
+	float StreamingBudget = 0.0f;
+
+	/** Draw streamed out rooms through their tile's proxy mesh, instanced on the generator. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Streaming", EditAnywhere, meta = (EditCondition = "bStreamRooms"))
+	bool bDrawRoomProxies = true;
+
+	/**
+	 * Load each distinct tile level once per layout, golden path first, and keep
+	 * it loaded across regenerations. Room instances then only load their own
+	 * level contents; shared assets are already in memory. Pinned packages are
+	 * not counted against StreamingBudget, so leave this off when memory is
+	 * capped, or call FlushLevelPackageCache under pressure.
+	 */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Streaming", EditAnywhere)
+	bool bCacheLevelPackages = false;
+
+	/** Number of rooms worth of managers, doors and seals to pool when play begins. Zero disables prewarming. */
+	UPROPERTY(BlueprintReadWrite, Category = "Generation|Pooling", EditAnywhere, meta = (ClampMin = 0))
+	int32 PrewarmRoomCount = 0;
+
+	/** Locked golden path doors, indexed like Constraints.LockedPathIndices. Only populated while HasGenerated is true. */
+	UPROPERTY(BlueprintReadOnly, Category = "Generation")
+	TArray<ARoomDoor*> LockedDoors;
+
 	/** Generated level data managers. Only populated while HasGenerated is true. */
 	UPROPERTY(BlueprintReadOnly, Category = "Generation")
 	TArray<ARoomManager*> RoomGrid;
 
+	/** Invoked once every room and door of a generated level has been spawned. */
+	UPROPERTY(BlueprintAssignable, Category = "Generation")
+	FOnLevelGenerated OnLevelGenerated;
+
 	/** Constructs the Generator. */
 	AGenerator();
 
@@ -48,10 +251,71 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Generation")
 	void GenerateLevel();
 
-	/** Unloads the currently-generated level. */
+	/** Fills the actor pools with enough managers, doors and seals for a level of the given room count. */
+	UFUNCTION(BlueprintCallable, Category = "Generation")
+	void PrewarmPools(int32 ExpectedRooms);
+
+	/**
+	 * Rebuilds a level from layout data saved by another generation, without
+	 * solving. The generator must use the same tileset as the saved level.
+	 *
+	 * @param Data Layout data returned by GetLayoutData.
+	 * @return False if the data can't be loaded against this generator's tileset.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Generation")
+	bool GenerateLevelFromData(const TArray<uint8>& Data);
+
+	/**
+	 * Solves a layout for each of the given seeds in parallel, with the
+	 * generator's current settings, without spawning anything. Any of them
+	 * can be spawned later with GenerateLevelFromLayout.
+	 *
+	 * @param Seeds Seed of each layout.
+	 * @param OutLayouts Returned layouts, matching Seeds by index.
+	 */
+	void SolveLayouts(TConstArrayView<int32> Seeds, TArray<FDungeonLayout>& OutLayouts);
+
+	/**
+	 * Spawns a level from a layout returned by SolveLayouts. The tileset must
+	 * not have changed in between.
+	 *
+	 * @return False if a level already exists or the layout has no rooms.
+	 */
+	bool GenerateLevelFromLayout(const FDungeonLayout& Layout);
+
+	/**
+	 * Solves the given seeds with the generator's current settings and writes
+	 * them into the baked layout cache. Used by the BakeLayouts commandlet.
+	 *
+	 * @return The number of layouts written.
+	 */
+	int32 BakeLayoutCache(TConstArrayView<int32> Seeds);
+
+	/** Returns the compact binary layout of the current level, or nothing if no level has generated. */
+	UFUNCTION(BlueprintPure, Category = "Generation")
+	TArray<uint8> GetLayoutData() const;
+
+	/** Unloads the currently-generated level. Its actors are returned to the pool for the next generation. */
 	UFUNCTION(BlueprintCallable, Category = "Generation")
 	void ReleaseLevel();
 
+	/**
+	 * Loads, shows, hides and unloads room levels around the rooms the players
+	 * are in. Called whenever a player changes rooms while bStreamRooms is set.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Generation")
+	void UpdateRoomStreaming();
+
+	/** Lets go of every cached tile level package. Rooms already spawned stay loaded. */
+	UFUNCTION(BlueprintCallable, Category = "Generation")
+	void FlushLevelPackageCache();
+
+	/** Returns the door actor of the given open doorway, spawning it in place of its instance if needed. */
+	ARoomDoor* GetDoorwayActor(int32 DoorwayIndex);
+
+	/** Returns the world transform of the given open doorway, or nullptr if there is no such doorway. */
+	const FTransform* GetDoorwayTransform(int32 DoorwayIndex) const;
+
 	/** Spawns an open or sealed door at the given position with the given direction. */
 	UFUNCTION(BlueprintCallable, Category = "Generation")
 	ARoomDoor* SpawnDoor(const FVector& DoorPosition, const FVector& DoorDirection, bool bSpawnSealed = false);
@@ -60,16 +324,170 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Generation")
 	bool HasGenerated() const;
 
+	/** Checks to see if an asynchronous generation is still solving or spawning. */
+	UFUNCTION(BlueprintPure, Category = "Generation")
+	bool IsGenerating() const;
+
+	/** Returns the counters of the most recent layout solve. */
+	const FDungeonSolveStats& GetLastSolveStats() const
+	{
+		return LastSolveStats;
+	}
+
+	/** Returns which constraints the current level meets and how long its solve took. */
+	UFUNCTION(BlueprintPure, Category = "Generation")
+	FGenerationReport GetGenerationReport() const;
+
+	/** Returns the door locked by the given entry of Constraints.LockedPathIndices, if it was placed. */
+	UFUNCTION(BlueprintPure, Category = "Generation")
+	ARoomDoor* GetLockedDoor(int32 LockIndex) const;
+
+	/** Returns the manager occupying the given grid cell, if any. */
+	UFUNCTION(BlueprintPure, Category = "Generation")
+	ARoomManager* FindRoomAtCell(const FIntVector& Cell) const;
+
+	/** Returns the grid cell containing the given world location. Only meaningful while HasGenerated is true. */
+	UFUNCTION(BlueprintPure, Category = "Generation")
+	FIntVector GetCellAtLocation(const FVector& WorldLocation) const;
+
+	/** Returns the manager whose grid cell contains the given world location, if any. */
+	UFUNCTION(BlueprintPure, Category = "Generation")
+	ARoomManager* FindRoomAtLocation(const FVector& WorldLocation) const;
+
+	/** Checks whether the given room's level is loaded and shown, so that its geometry collides. */
+	UFUNCTION(BlueprintPure, Category = "Generation")
+	bool IsRoomLevelShown(const ARoomManager* Room) const;
+
+	/** Prewarms the actor pools if requested. */
+	virtual void BeginPlay() override;
+
+	/**
+	 * Advances asynchronous generation once per frame.
+	 *
+	 * @param DeltaSeconds Seconds since last update.
+	 */
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Waits for any in-flight solve before the generator leaves play. */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 private:
 
 	/** Spawns a room manager at the given transform. */
 	ARoomManager* SpawnManager(const FTransform& RoomTransform);
 
-	/** Helper function that returns a randomly-selected room tile with the given type. */
-	URoomData* GetRandomRoomTile(ERoomType RoomType, int32 MaxTries = 100) const;
+	/** Copies the tileset into a solver tileset. Called once before each generation. */
+	void BuildDungeonTileset();
+
+	/** Returns the solve settings for the given seed. */
+	FDungeonSolveParams MakeSolveParams(int32 SolveSeed) const;
+
+	/** Returns the solver's copy of Constraints. */
+	FDungeonConstraints MakeSolveConstraints() const;
+
+	/** Returns the layout cache key for the given seed. Requires a built solver tileset. */
+	FDungeonLayoutCacheKey MakeLayoutCacheKey(int32 SolveSeed) const;
+
+	/** Checks whether a solved layout may go into the layout cache: it has a start room and meets its constraints. */
+	static bool IsLayoutCacheable(const FDungeonLayout& Layout);
+
+	/** Spawns all of the pending layout right now, then finishes the generation. */
+	void SpawnPendingLayout();
+
+	/** Spawns the next room or door of the pending layout. Returns false once everything is spawned. */
+	bool SpawnLayoutStep();
+
+	/** Finishes a generation and broadcasts OnLevelGenerated. */
+	void FinishGeneration();
+
+	/** Starts loading the distinct tile levels of the given layout that are not cached yet. */
+	void RequestLevelPackages(const FDungeonLayout& Layout);
+
+	/** Checks whether every requested tile level has finished loading. */
+	bool AreLevelPackagesLoaded() const;
+
+	/** Blocks until every requested tile level has finished loading. */
+	void WaitForLevelPackages();
+
+	/** Requests the level of the given room, creating its level instance on first use. */
+	void LoadRoomLevel(FGeneratedRoomLevel& RoomLevel, bool bVisible);
+
+	/** Creates an instanced mesh component on the generator for drawing the given mesh. */
+	UHierarchicalInstancedStaticMeshComponent* CreateInstanceComponent(UStaticMesh* Mesh);
+
+	/** Rebuilds the proxy instances of every room whose level isn't showing. */
+	void RefreshRoomProxies();
+
+	/** Swaps a room's proxy for its level once the level is shown. */
+	UFUNCTION()
+	void HandleRoomLevelShown();
+
+	/** Updates room streaming when a player moves between rooms. */
+	UFUNCTION()
+	void HandlePawnRoomChanged(APawn* Pawn, ARoomManager* PreviousRoom, ARoomManager* CurrentRoom);
+
+	/** Stops tracking rooms and room changes in the occupancy subsystem. */
+	void UnregisterOccupancy();
+
+	/** Solver copy of the tileset, rebuilt before each generation. */
+	FDungeonTileset DungeonTileset;
+
+	/** Tile assets matching each entry of DungeonTileset. */
+	TArray<URoomData*> DungeonTileAssets;
+
+	/** Maps occupied grid cells to indices into RoomGrid. */
+	FRoomCellGrid RoomCells;
+
+	/** World location of the center of cell zero. */
+	FVector GridOrigin = FVector::ZeroVector;
+
+	/** World rotation of the grid axes; the start room's rotation. */
+	FQuat GridRotation = FQuat::Identity;
+
+	/** World size of a single grid cell. */
+	FVector GridCellSize = FVector::OneVector;
+
+	/** Layout currently being solved or spawned. */
+	TSharedPtr<FDungeonLayout, ESPMode::ThreadSafe> PendingLayout;
+
+	/** Background solve of the pending layout. */
+	UE::Tasks::FTask SolveTask;
+
+	/** Counters of the most recent layout solve. */
+	FDungeonSolveStats LastSolveStats;
+
+	/** Saved form of the current level's layout. */
+	TArray<uint8> LayoutData;
+
+	/** Whether the pending layout is a fresh solve that should go into the layout cache. */
+	bool bStorePendingLayout = false;
+
+	/** Index of the next room, then door, of the pending layout to spawn. */
+	int32 SpawnCursor = 0;
+
+	/** Instanced proxies of streamed out rooms, one component per proxy mesh. */
+	UPROPERTY(Transient)
+	TMap<UStaticMesh*, UHierarchicalInstancedStaticMeshComponent*> RoomProxies;
+
+	/** Instances of every seal, when SealMesh is set. */
+	UPROPERTY(Transient)
+	UHierarchicalInstancedStaticMeshComponent* SealInstances = nullptr;
+
+	/** Instances of every open doorway, when DoorMesh is set. Instance indices match Doorways. */
+	UPROPERTY(Transient)
+	UHierarchicalInstancedStaticMeshComponent* DoorInstances = nullptr;
+
+	/** Seal transforms gathered while spawning, added as instances in one go. */
+	TArray<FTransform> PendingSeals;
+
+	/** Open doorways of the generated level, when DoorMesh is set. */
+	TArray<FGeneratedDoorway> Doorways;
+
+	/** Loaded or loading tile levels, kept across regenerations. */
+	TMap<FSoftObjectPath, TSharedPtr<FStreamableHandle>> LevelPackages;
 
-	/** Holds pointers to the active level instances. */
-	TArray<ULevelStreamingDynamic*> LevelStreams;
+	/** Level instance of each generated room, matching RoomGrid. */
+	TArray<FGeneratedRoomLevel> RoomLevels;
 
 	/** Holds pointers to actors spawned during generation. */
 	TArray<AActor*> ActorSpawns;
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Bridson's Poisson-disk sampling over the floor of a box. Points are spread
+ * so that no two are closer than the given spacing horizontally, with a
+ * random height inside the box.
+ */
+struct DESCENTCORE_API FPoissonDiskSampler
+{
+public:
+
+	/**
+	 * Fills the box with evenly spaced random points.
+	 *
+	 * @param Bounds Box to sample inside.
+	 * @param MinDistance Minimum horizontal distance between any two points.
+	 * @param Stream Random stream driving the sampling.
+	 * @param OutPoints Returned points, replacing any previous contents.
+	 * @param MaxAttempts Candidates tried around each point before it is retired.
+	 */
+	static void Sample(const FBox& Bounds, float MinDistance, FRandomStream& Stream, TArray<FVector>& OutPoints, int32 MaxAttempts = 30);
+};
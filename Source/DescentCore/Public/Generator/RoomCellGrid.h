@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Cells covered by a room on each of its floors, as an 8x8 bitboard around
+ * the room's center cell. Bit X + 8 * Y stands for the cell offset by
+ * X - Center and Y - Center along the grid's X and Y axes.
+ */
+struct DESCENTCORE_API FRoomFootprint
+{
+	/** Board coordinate of the room's center cell on both axes. */
+	static constexpr int32 Center = 3;
+
+	/** Widest footprint that fits the board around its center cell. */
+	static constexpr int32 MaxSize = 2 * Center + 1;
+
+	/** Board with only the center cell set. */
+	static constexpr uint64 CenterCell = 1ull << (Center + 8 * Center);
+
+	/** Covered cells on each floor. */
+	uint64 Cells = CenterCell;
+
+	/** Number of floors the room spans, starting at its center cell. */
+	int32 Floors = 1;
+};
+
+/**
+ * Integer-keyed spatial hash mapping unit grid cells to room indices.
+ * Occupancy is also kept as 8x8 bitboards per floor, so a whole room
+ * footprint is tested with a handful of lookups whatever its size.
+ */
+struct DESCENTCORE_API FRoomCellGrid
+{
+public:
+
+	/** Clears the grid and reserves space for the expected number of rooms. */
+	void Reset(int32 ExpectedRooms = 0);
+
+	/** Checks whether any room occupies the given cell. */
+	bool IsOccupied(const FIntVector& Cell) const
+	{
+		return Cells.Contains(Cell);
+	}
+
+	/** Checks whether any room occupies a cell of the given footprint centered on the given cell. */
+	bool Overlaps(const FIntVector& Center, const FRoomFootprint& Footprint) const;
+
+	/** Returns the index of the room occupying the given cell, or INDEX_NONE. */
+	int32 FindRoom(const FIntVector& Cell) const;
+
+	/**
+	 * Marks the cells of a footprint as occupied by the given room.
+	 *
+	 * @param Center Cell the footprint is centered on, on the room's lowest floor.
+	 * @param Footprint Cells covered by the room.
+	 * @param RoomIndex Index of the room taking the cells.
+	 * @return False, leaving the grid untouched, if any cell was already occupied.
+	 */
+	bool TryOccupy(const FIntVector& Center, const FRoomFootprint& Footprint, int32 RoomIndex);
+
+	/** Marks the given cell as occupied by the given room. Returns false if it was already occupied. */
+	bool TryOccupy(const FIntVector& Cell, int32 RoomIndex)
+	{
+		return TryOccupy(Cell, FRoomFootprint(), RoomIndex);
+	}
+
+	/** Frees the cells of a footprint so that another room can take them. */
+	void Release(const FIntVector& Center, const FRoomFootprint& Footprint);
+
+	/** Returns the number of occupied cells. */
+	int32 Num() const
+	{
+		return Cells.Num();
+	}
+
+	/** Rounds a unit grid vector to its nearest integer cell. */
+	static FIntVector ToCell(const FVector& GridVector);
+
+private:
+
+	/**
+	 * Calls the given function with each board-aligned piece of a footprint
+	 * floor. A footprint straddles at most four boards.
+	 */
+	template <typename FunctionType>
+	static void ForEachBoard(const FIntVector& Center, uint64 Footprint, FunctionType&& Function);
+
+	/** Maps occupied cells to the index of the room holding them. */
+	TMap<FIntVector, int32> Cells;
+
+	/** Occupancy of each 8x8 block of cells, keyed by block. */
+	TMap<FIntVector, uint64> Boards;
+};
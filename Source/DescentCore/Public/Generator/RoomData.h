@@ -4,6 +4,9 @@
 #include "Engine/DataAsset.h"
 #include "RoomData.generated.h"
 
+class UStaticMesh;
+struct FDungeonTile;
+
 /** Defines a room's function. */
 UENUM(BlueprintType)
 enum class ERoomType : uint8
@@ -21,6 +24,20 @@ enum class ERoomType : uint8
 	Boss,
 };
 
+/** Defines what the solver picked a room to hold, on top of its type. */
+UENUM(BlueprintType)
+enum class ERoomRole : uint8
+{
+	/** The room holds nothing special. */
+	None,
+
+	/** The terminal holds the key to a locked golden path door. */
+	Key,
+
+	/** The terminal holds treasure. */
+	Treasure,
+};
+
 /** Defines a room's door configuration. */
 UENUM(meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = true))
 enum class ERoomDoorFlags : uint8
@@ -75,6 +92,10 @@ public:
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, meta = (Bitmask, BitmaskEnum = ERoomDoorFlags))
 	int32 DoorFlags = 0;
 
+	/** Relative chance of this tile being picked over others of the same type. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, meta = (ClampMin = 0))
+	float Weight = 1.0f;
+
 	/** Room width and depth measured in meters. */
 	UPROPERTY(BlueprintReadOnly, EditAnywhere)
 	int32 RoomSize = 20;
@@ -83,6 +104,41 @@ public:
 	UPROPERTY(BlueprintReadOnly, EditAnywhere)
 	int32 RoomHeight = 12;
 
+	/**
+	 * Grid cells along each side of the room's footprint. Rooms larger than
+	 * one cell claim every covered cell when placed. Even sizes are rounded
+	 * up so that the room centers on a cell. Every tile of a tileset must
+	 * have the same RoomSize per cell, and RoomHeight per floor, as its start
+	 * rooms; the generator ignores tiles that don't.
+	 */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, meta = (ClampMin = 1, ClampMax = 7))
+	int32 FootprintSize = 1;
+
+	/**
+	 * Cells of the footprint square the room covers, in its default rotation.
+	 * Bit X + FootprintSize * Y is the cell X north and Y east of the
+	 * south-west corner. Zero covers the whole square. The center cell, and
+	 * the middle cell of the southern edge and of each door's edge, are
+	 * always covered, since rooms are entered and left through them.
+	 */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere)
+	int64 FootprintMask = 0;
+
+	/** Grid floors the room spans. Its upper doors lead out above the topmost one. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, meta = (ClampMin = 1))
+	int32 FootprintFloors = 1;
+
+	/**
+	 * Merged mesh of the room's level, drawn in place of the level while the
+	 * room is streamed out. Its pivot must match the level's origin.
+	 */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere)
+	UStaticMesh* ProxyMesh = nullptr;
+
+	/** Approximate memory used by the room's level while loaded. Counted against generator streaming budgets. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, meta = (ClampMin = 0, Units = "MB"))
+	float MemoryEstimate = 32.0f;
+
 	/**
 	 * Calculates the world position and direction of a door for the given room transform.
 	 *
@@ -98,4 +154,7 @@ public:
 	/** Returns the room transform needed to connect with the given entrance point and direction. */
 	UFUNCTION(BlueprintPure, Category = "Room Generation")
 	FTransform GetConnectionTransformFrom(const FVector EntryPoint, const FVector EntryDirection) const;
+
+	/** Returns a plain copy of the room's layout data for use by the layout solver. */
+	FDungeonTile GetDungeonTile() const;
 };
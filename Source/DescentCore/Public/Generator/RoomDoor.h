@@ -2,29 +2,57 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Pooling/PooledActorInterface.h"
 #include "RoomDoor.generated.h"
 
+class ARoomDoor;
+
+/** Invoked when a door opens, closes, locks or unlocks. */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnDoorStateChanged, ARoomDoor*, Door, bool, bIsOpen, bool, bIsLocked);
+
 /**
  * Very abstract base class for door actors. Provides lock logic.
+ * Doors don't tick; visuals react to OnDoorStateChanged and only tick
+ * while an animation is playing.
  */
 UCLASS(Abstract)
-class DESCENTCORE_API ARoomDoor : public AActor
+class DESCENTCORE_API ARoomDoor : public AActor, public IPooledActor
 {
 	GENERATED_BODY()
 	
 public:
 
-	/** Whether the door is locked or unlocked. */
-	UPROPERTY(BlueprintReadWrite, Category = "Door", EditAnywhere)
+	/**
+	 * Whether the door is locked or unlocked. To set from native code, call
+	 * SetLocked. Blueprint writes go through SetLocked, so existing Set nodes
+	 * keep working and notify OnDoorStateChanged.
+	 */
+	UPROPERTY(BlueprintReadWrite, BlueprintSetter = SetLocked, Category = "Door", EditAnywhere)
 	bool IsLocked = false;
 
+	/** Whether the door stays locked until a key is used on it. Rooms leave such doors locked when cleared. */
+	UPROPERTY(BlueprintReadOnly, Category = "Door")
+	bool bRequiresKey = false;
+
 	/** Whether the door is open or closed. To set, call TryOpen or TryClose. */
 	UPROPERTY(BlueprintReadOnly, Category = "Door", EditAnywhere)
 	bool IsOpen = false;
 
+	/** Invoked whenever the door opens, closes, locks or unlocks. */
+	UPROPERTY(BlueprintAssignable, Category = "Door")
+	FOnDoorStateChanged OnDoorStateChanged;
+
 	/** Constructs the Door. */
 	ARoomDoor();
 
+	/** Locks or unlocks the door. Does not open or close it. */
+	UFUNCTION(BlueprintCallable, Category = "Door")
+	void SetLocked(bool bLocked);
+
+	/** Lifts the key requirement and unlocks the door. */
+	UFUNCTION(BlueprintCallable, Category = "Door")
+	void UseKey();
+
 	/** Tries to open the door, optionally ignoring the lock. */
 	UFUNCTION(BlueprintCallable, Category = "Door")
 	void TryOpen(bool bIgnoreLock = false);
@@ -32,4 +60,16 @@ public:
 	/** Tries to close the door, optionally ignoring the lock. */
 	UFUNCTION(BlueprintCallable, Category = "Door")
 	void TryClose(bool bIgnoreLock = true);
+
+	/** Turns ticking on for the length of an open or close animation. Call again with false once it ends. */
+	UFUNCTION(BlueprintCallable, Category = "Door")
+	void SetAnimating(bool bAnimating);
+
+	/** Returns the door to its spawned state, unlocked, keyless and closed. */
+	virtual void OnReturnedToPool_Implementation() override;
+
+private:
+
+	/** Applies a new state, broadcasting OnDoorStateChanged if anything changed. */
+	void SetDoorState(bool bOpen, bool bLocked);
 };
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Generator/RoomData.h"
+
+/** Static description of a single door flag in a room's default rotation. */
+struct FRoomDoorInfo
+{
+	/** Local forward (north) component of the door direction. */
+	int32 DirectionX = 0;
+
+	/** Local right (east) component of the door direction. */
+	int32 DirectionY = 0;
+
+	/** Whether the door sits on the upper level of the room. */
+	bool bAscent = false;
+
+	/** Quarter turns from north to the door direction, clockwise seen from above. */
+	int32 Yaw = 0;
+};
+
+namespace RoomDoors
+{
+	/** Number of door flags a room can have. */
+	inline constexpr int32 Count = 8;
+
+	static_assert((int32)ERoomDoorFlags::UpperDoorWest == 1 << (Count - 1), "Door table must cover every ERoomDoorFlags bit.");
+
+	/** Door descriptions indexed by the bit position of their flag. */
+	inline constexpr FRoomDoorInfo Table[Count] =
+	{
+		{  1,  0, false, 0 }, // LowerDoorNorth
+		{ -1,  0, false, 2 }, // LowerDoorSouth
+		{  0,  1, false, 1 }, // LowerDoorEast
+		{  0, -1, false, 3 }, // LowerDoorWest
+		{  1,  0, true,  0 }, // UpperDoorNorth
+		{ -1,  0, true,  2 }, // UpperDoorSouth
+		{  0,  1, true,  1 }, // UpperDoorEast
+		{  0, -1, true,  3 }, // UpperDoorWest
+	};
+
+	/** Every door mask turned by each number of quarter turns, built at compile time. */
+	struct FRotatedMasks
+	{
+		uint8 Masks[4][1 << Count];
+
+		constexpr FRotatedMasks()
+			: Masks{}
+		{
+			// Table index of the lower door facing each yaw.
+			constexpr int32 DoorOfYaw[4] = { 0, 2, 1, 3 };
+
+			for (int32 Yaw = 0; Yaw < 4; Yaw++)
+			{
+				for (int32 Mask = 0; Mask < (1 << Count); Mask++)
+				{
+					int32 Rotated = 0;
+
+					for (int32 Index = 0; Index < Count; Index++)
+					{
+						if (Mask & (1 << Index))
+						{
+							const int32 Level = Index & ~3;
+							Rotated |= 1 << (Level + DoorOfYaw[(Table[Index].Yaw + Yaw) & 3]);
+						}
+					}
+
+					Masks[Yaw][Mask] = (uint8)Rotated;
+				}
+			}
+		}
+	};
+
+	/** Rotated door masks, indexed by quarter turns and then by mask. */
+	inline constexpr FRotatedMasks RotatedMasks;
+
+	/**
+	 * Turns a door mask by the given number of quarter turns, so that a
+	 * room's doors can be read in grid directions.
+	 *
+	 * @param DoorMask Door flags in the room's own rotation.
+	 * @param Yaw Quarter turns of the room, clockwise seen from above.
+	 * @return The same doors in grid directions.
+	 */
+	inline int32 Rotate(int32 DoorMask, int32 Yaw)
+	{
+		return RotatedMasks.Masks[Yaw & 3][DoorMask & ((1 << Count) - 1)];
+	}
+
+	/** Returns the table index of a single door flag, or INDEX_NONE if it is not exactly one flag. */
+	inline int32 IndexOf(int32 DoorFlag)
+	{
+		if (DoorFlag <= 0 || DoorFlag >= (1 << Count) || (DoorFlag & (DoorFlag - 1)) != 0)
+		{
+			return INDEX_NONE;
+		}
+
+		return (int32)FMath::CountTrailingZeros((uint32)DoorFlag);
+	}
+
+	/** Returns the description of a single door flag. The flag must be valid. */
+	inline const FRoomDoorInfo& Get(int32 DoorFlag)
+	{
+		const int32 Index = IndexOf(DoorFlag);
+		check(Index != INDEX_NONE);
+		return Table[Index];
+	}
+
+	/**
+	 * Picks one set bit from a door mask with a single random draw.
+	 *
+	 * @param DoorMask Mask of candidate door flags.
+	 * @param Stream Stream to draw from.
+	 * @return A single door flag from the mask, or zero if the mask is empty.
+	 */
+	inline int32 SelectRandom(int32 DoorMask, FRandomStream& Stream)
+	{
+		DoorMask &= (1 << Count) - 1;
+
+		if (DoorMask == 0)
+		{
+			return 0;
+		}
+
+		// Drop the lowest set bits until the chosen one is lowest.
+		for (int32 Skip = Stream.RandHelper(static_cast<int32>(FMath::CountBits(DoorMask))); Skip > 0; --Skip)
+		{
+			DoorMask &= DoorMask - 1;
+		}
+
+		return DoorMask & -DoorMask;
+	}
+}
@@ -2,11 +2,15 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Generator/RoomData.h"
+#include "Pooling/PooledActorInterface.h"
 #include "RoomManager.generated.h"
 
 // Forward declarations.
+class AGenerator;
 class URoomData;
 class ARoomDoor;
+class APawn;
 
 /** Information about an individual spawn grouping. */
 USTRUCT(BlueprintType)
@@ -29,9 +33,25 @@ public:
 	bool bRequireDestroy = false;
 };
 
+/** A single enemy of a planned spawn wave. */
+struct FPlannedSpawn
+{
+	/** Class of actor to spawn. */
+	UClass* ActorClass = nullptr;
+
+	/** World transform to spawn the actor at. */
+	FTransform Transform;
+
+	/** Whether the actor must be destroyed to "beat" the spawn. */
+	bool bRequireDestroy = false;
+
+	/** Whether the position was checked against the room's geometry and needs no collision fixup. */
+	bool bPrevalidated = false;
+};
+
 /** Represents and manages a generated room instance. */
 UCLASS()
-class DESCENTCORE_API ARoomManager : public AActor
+class DESCENTCORE_API ARoomManager : public AActor, public IPooledActor
 {
 	GENERATED_BODY()
 
@@ -45,6 +65,18 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category = "Room Manager", EditAnywhere)
 	FVector SpawnExtent;
 
+	/** Minimum distance between cached spawn points. */
+	UPROPERTY(BlueprintReadOnly, Category = "Room Manager", EditAnywhere, meta = (ClampMin = 1, Units = "cm"))
+	float SpawnPointSpacing = 150.0f;
+
+	/** Radius around each cached spawn point that must be clear of level geometry. Zero skips the check. */
+	UPROPERTY(BlueprintReadOnly, Category = "Room Manager", EditAnywhere, meta = (ClampMin = 0, Units = "cm"))
+	float SpawnPointRadius = 50.0f;
+
+	/** Game thread time spent spawning enemies per frame. Zero spawns whole waves at once. */
+	UPROPERTY(BlueprintReadWrite, Category = "Room Manager", EditAnywhere, meta = (ClampMin = 0, Units = "ms"))
+	float SpawnBudgetMilliseconds = 0.0f;
+
 	/** Room data asset used to construct this room. */
 	UPROPERTY(BlueprintReadOnly, Category = "Room Data")
 	URoomData* Template = nullptr;
@@ -53,14 +85,36 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category = "Room Data")
 	int32 PathIndex = 0;
 
-	/** Unit grid position for this room. */
+	/** What the solver picked this room to hold. */
+	UPROPERTY(BlueprintReadOnly, Category = "Room Data")
+	ERoomRole Role = ERoomRole::None;
+
+	/** For key rooms, the generator lock whose door the key opens. See AGenerator::GetLockedDoor. */
+	UPROPERTY(BlueprintReadOnly, Category = "Room Data")
+	int32 LockIndex = INDEX_NONE;
+
+	/** Integer grid cell for this room. */
 	UPROPERTY(BlueprintReadOnly, Category = "Room Data")
-	FVector GridPosition;
+	FIntVector GridPosition;
+
+	/** Random stream used by spawns in this room. Seeded by the generator. */
+	UPROPERTY(BlueprintReadWrite, Category = "Room Manager")
+	FRandomStream SpawnStream;
 
 	/** Transform of the streamed room instance. */
 	UPROPERTY(BlueprintReadOnly)
 	FTransform RoomTransform;
 
+	/** Generator that built this room. */
+	UPROPERTY(BlueprintReadOnly, Category = "Room Data")
+	AGenerator* Generator = nullptr;
+
+	/** Generator doorway of the room's entrance, while it is drawn as an instance. */
+	int32 EntranceDoorway = INDEX_NONE;
+
+	/** Generator doorways of the room's exits, while they are drawn as instances. */
+	TArray<int32> ExitDoorways;
+
 	/** Tracks the room's entrance door. */
 	UPROPERTY(BlueprintReadOnly, Category = "Room Data")
 	ARoomDoor* EntranceDoor = nullptr;
@@ -72,26 +126,55 @@ public:
 	/** Constructs the Manager. */
 	ARoomManager();
 
-	/** Invoked whenever the player enters the room managed by this manager. */
+	/** Invoked whenever the first player enters the room managed by this manager. */
 	UFUNCTION(BlueprintImplementableEvent, Category = "Room Manager|Events")
 	void OnPlayerEnterRoom();
 
+	/** Invoked whenever the last player leaves the room managed by this manager. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Room Manager|Events")
+	void OnPlayerExitRoom();
+
+	/** Invoked whenever any player pawn enters the room. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Room Manager|Events")
+	void OnPawnEnterRoom(APawn* Pawn);
+
+	/** Invoked whenever any player pawn leaves the room. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Room Manager|Events")
+	void OnPawnExitRoom(APawn* Pawn);
+
 	/** Invoked when the player kills all required enemies. */
 	UFUNCTION(BlueprintImplementableEvent, Category = "Room Manager|Events")
 	void OnPlayerKillRequired();
 
+	/** Turns the room's instanced doorways into door actors. Called before locking or unlocking. */
+	UFUNCTION(BlueprintCallable, Category = "Room Manager|Events")
+	void SpawnDoorActors();
+
 	/** Locks all exit doors and closes them. */
 	UFUNCTION(BlueprintCallable, Category = "Room Manager|Events")
 	virtual void LockRoom(bool bTryLockEntrance = true);
 
-	/** Unlocks all exit doors. */
+	/** Unlocks all exit doors, except those waiting on a key. */
 	UFUNCTION(BlueprintCallable, Category = "Room Manager|Events")
 	virtual void UnlockRoom(bool bTryUnlockEntrance = false);
 
-	/** Spawns the given parameter sequence. */
+	/**
+	 * Spawns the given parameter sequence. Every position is planned up front,
+	 * drawn without repeats from the template's cached spawn points, and actors
+	 * are taken from the world's actor pool. With a spawn budget the wave is
+	 * spread over several frames.
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Room Manager|Spawns")
 	virtual void BeginSpawn(const TArray<FSpawnParams>& SpawnSequence);
 
+	/**
+	 * Counts a spawn as killed and stops tracking it. Only needed for enemies
+	 * that are released to the pool on death instead of being destroyed;
+	 * call it before releasing them.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Room Manager|Spawns")
+	void NotifySpawnKilled(AActor* Actor);
+
 	/** Clears spawned actors and resets the spawn gate. */
 	UFUNCTION(BlueprintCallable, Category = "Room Manager|Spawns")
 	virtual void ClearSpawns();
@@ -99,7 +182,19 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Room Manager|State")
 	bool IsPlayerInside()
 	{
-		return bPlayerInside;
+		return !Occupants.IsEmpty();
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Room Manager|State")
+	int32 GetOccupantCount()
+	{
+		return Occupants.Num();
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Room Manager|State")
+	TArray<APawn*> GetOccupants()
+	{
+		return Occupants;
 	}
 
 	UFUNCTION(BlueprintPure, Category = "Room Manager|State")
@@ -114,27 +209,66 @@ public:
 		return RequireCount > 0;
 	}
 
+	UFUNCTION(BlueprintPure, Category = "Room Manager|State")
+	bool IsSpawning()
+	{
+		return PlannedSpawnCursor < PlannedSpawns.Num();
+	}
+
 	/**
-	 * Updates the Manager once per frame.
+	 * Spawns the next part of a budgeted wave.
 	 *
 	 * @param DeltaSeconds Seconds since last update.
 	 */
 	virtual void Tick(float DeltaSeconds) override;
 
+	/** Stops listening for enemy deaths. */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Clears spawns, doors and occupants so the manager can be reused for another room. */
+	virtual void OnReturnedToPool_Implementation() override;
+
+	/** Checks whether the given location is inside the room and clear of its entrance doorway. */
+	bool IsLocationInside(const FVector& Location) const;
+
+	/** Called by the room occupancy subsystem when a player pawn enters the room. */
+	void NotifyPawnEnter(APawn* Pawn);
+
+	/** Called by the room occupancy subsystem when a player pawn leaves the room. */
+	void NotifyPawnExit(APawn* Pawn);
+
 private:
 
-	/** Checks the player location for entrances. */
-	void CheckPlayerEntrance();
+	/** Spawns the next planned actor. Returns false once the wave is done. */
+	bool SpawnPlannedStep();
+
+	/** Counts destroyed required actors. Bound to the world only while any are alive. */
+	void HandleActorDestroyed(AActor* Actor);
 
-	/** Delegate callback used to reduce the tracked require count. */
-	UFUNCTION()
-	void ReduceRequireCount();
+	/** Reduces the tracked require count for the given actor, if it was required. */
+	void ReduceRequireCount(AActor* Actor);
 
-	/** Tracks whether the player is in the room. */
-	bool bPlayerInside = false;
+	/** Stops listening for actor destruction. */
+	void UnbindActorDestroyed();
+
+	/** Tracks the player pawns in the room. */
+	UPROPERTY(Transient)
+	TArray<APawn*> Occupants;
 
 	/** Tracks the currently spawned actors. */
-	TArray<AActor*> SpawnActors;
+	TArray<TWeakObjectPtr<AActor>> SpawnActors;
+
+	/** Positions and classes of the current wave. */
+	TArray<FPlannedSpawn> PlannedSpawns;
+
+	/** Index of the next planned actor to spawn. */
+	int32 PlannedSpawnCursor = 0;
+
+	/** Spawned actors that still need to be killed. */
+	TSet<const AActor*> RequiredSpawns;
+
+	/** World actor destruction handler, valid while required actors are alive. */
+	FDelegateHandle ActorDestroyedHandle;
 
 	/** Tracks the remaining required actors. */
 	int32 RequireCount = 0;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RoomOccupancySubsystem.generated.h"
+
+class AGenerator;
+class APawn;
+class ARoomManager;
+
+/** Invoked when a player pawn moves from one room to another. Either room may be null. */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnPawnRoomChanged, APawn*, Pawn, ARoomManager*, PreviousRoom, ARoomManager*, CurrentRoom);
+
+/**
+ * Tracks which generated room each player pawn is in. Every frame makes a
+ * single pass over the players, mapping each pawn to a grid cell, so the
+ * cost grows with player count rather than room count. Managers are only
+ * notified when a pawn crosses between rooms.
+ */
+UCLASS()
+class DESCENTCORE_API URoomOccupancySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Invoked whenever a player pawn's current room changes. */
+	UPROPERTY(BlueprintAssignable, Category = "Room Occupancy")
+	FOnPawnRoomChanged OnPawnRoomChanged;
+
+	/** Starts tracking rooms of the given generator. Called once its level has spawned. */
+	void RegisterGenerator(AGenerator* Generator);
+
+	/** Stops tracking rooms of the given generator, removing every pawn from its rooms. */
+	void UnregisterGenerator(AGenerator* Generator);
+
+	/** Returns the room the given pawn is currently in, if any. */
+	UFUNCTION(BlueprintPure, Category = "Room Occupancy")
+	ARoomManager* GetPawnRoom(APawn* Pawn) const;
+
+	/** Updates every player pawn's room once per frame. */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Returns the stat used to profile the subsystem tick. */
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	/** Only game worlds have players to track. */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	/** Returns the room containing the given location across all generators, if any. */
+	ARoomManager* FindRoomContaining(const FVector& Location) const;
+
+	/** Moves a pawn between rooms, raising exit and enter events. */
+	void SetPawnRoom(APawn* Pawn, ARoomManager* PreviousRoom, ARoomManager* NewRoom);
+
+	/** Generators whose rooms are tracked. */
+	TArray<TWeakObjectPtr<AGenerator>> Generators;
+
+	/** Room each tracked pawn was in last frame. Pawns outside every room are not stored. */
+	TMap<TWeakObjectPtr<APawn>, TWeakObjectPtr<ARoomManager>> PawnRooms;
+};
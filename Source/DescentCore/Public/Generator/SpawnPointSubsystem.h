@@ -0,0 +1,90 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "SpawnPointSubsystem.generated.h"
+
+class ARoomManager;
+class URoomData;
+
+/** Identifies a spawn volume of a room template. */
+struct FSpawnPointKey
+{
+	/** Room template the volume belongs to. */
+	TObjectKey<URoomData> Template;
+
+	/** Center of the volume relative to the room. */
+	FVector Center = FVector::ZeroVector;
+
+	/** Half extent of the volume. */
+	FVector Extent = FVector::ZeroVector;
+
+	/** Minimum distance between points. */
+	float Spacing = 0.0f;
+
+	/** Radius kept clear of level geometry around each point. */
+	float Radius = 0.0f;
+
+	bool operator==(const FSpawnPointKey& Other) const
+	{
+		return Template == Other.Template && Center == Other.Center && Extent == Other.Extent
+			&& Spacing == Other.Spacing && Radius == Other.Radius;
+	}
+
+	friend uint32 GetTypeHash(const FSpawnPointKey& Key)
+	{
+		uint32 Hash = GetTypeHash(Key.Template);
+		Hash = HashCombine(Hash, GetTypeHash(Key.Center));
+		Hash = HashCombine(Hash, GetTypeHash(Key.Extent));
+		Hash = HashCombine(Hash, GetTypeHash(Key.Spacing));
+		return HashCombine(Hash, GetTypeHash(Key.Radius));
+	}
+};
+
+/** Sampled spawn points of a spawn volume, in room space. */
+struct FSpawnPointSet
+{
+	/** Spawn points relative to the room manager. */
+	TArray<FVector> Points;
+
+	/** Whether the points were checked against the room's level geometry. */
+	bool bValidated = false;
+};
+
+/**
+ * Caches evenly spaced spawn points for each room template's spawn volume.
+ * Points are sampled once per template, in room space, and checked against
+ * the level geometry of the first room that asks for them while its level
+ * is shown. Until then they are handed out unvalidated. Every later room
+ * built from the same template reuses them through its own transform.
+ */
+UCLASS()
+class DESCENTCORE_API USpawnPointSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/**
+	 * Returns the room-space spawn points of the given manager's spawn volume,
+	 * building them on first use. Empty if the manager has no template.
+	 * Points are only validated once a room of the template has its level shown.
+	 */
+	const FSpawnPointSet& GetSpawnPoints(const ARoomManager& Manager);
+
+	/** Drops every cached point set, for example after room levels change. */
+	UFUNCTION(BlueprintCallable, Category = "Room Spawns")
+	void ResetSpawnPoints();
+
+private:
+
+	/** Samples the points of a single spawn volume. */
+	static void SampleSpawnPoints(const ARoomManager& Manager, TArray<FVector>& OutPoints);
+
+	/** Drops points that overlap the level geometry of the given manager's room. */
+	void ValidateSpawnPoints(const ARoomManager& Manager, TArray<FVector>& InOutPoints) const;
+
+	/** Room-space spawn points of each known spawn volume. */
+	TMap<FSpawnPointKey, FSpawnPointSet> SpawnPoints;
+};
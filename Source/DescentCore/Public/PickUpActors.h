@@ -37,9 +37,6 @@ protected:
 	virtual void BeginPlay() override;
 
 public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 	//void PickUp_Implementation() override;
 
 	//void Utilize_Implementation() override;
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/World.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "ActorPoolSubsystem.generated.h"
+
+/** A deactivated actor and the state to restore when it is handed back out. */
+struct FParkedActor
+{
+	/** The parked actor. */
+	TWeakObjectPtr<AActor> Actor;
+
+	/** Whether the actor was hidden in game before it was parked. */
+	bool bHidden = false;
+
+	/** Whether the actor had collision enabled before it was parked. */
+	bool bCollisionEnabled = true;
+};
+
+/** Parked actors and counters for a single actor class. */
+struct FActorPoolBucket
+{
+	/** Deactivated actors ready to be handed out. */
+	TArray<FParkedActor> Free;
+
+	/** Acquisitions served from the pool. */
+	int32 Hits = 0;
+
+	/** Acquisitions that had to spawn a new actor. */
+	int32 Misses = 0;
+};
+
+/**
+ * Per-world actor pool keyed by class. Released actors are hidden, stop
+ * colliding and ticking, and are handed back out on the next acquire of the
+ * same class instead of spawning a new one. Reused actors get back the
+ * visibility and collision they had when released, and are placed with the
+ * same collision handling a spawn would use. Actors implementing
+ * IPooledActor get reset hooks on both transitions.
+ */
+UCLASS()
+class DESCENTCORE_API UActorPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/**
+	 * Takes an actor of the given class from the pool, or spawns one if the pool is empty.
+	 *
+	 * @param ActorClass Exact class of actor to acquire.
+	 * @param Transform Where to place the actor.
+	 * @param SpawnParameters Parameters used when a new actor has to be spawned. Their collision handling also places reused actors.
+	 * @return The acquired actor, or null if spawning failed or collision handling refused the transform.
+	 */
+	AActor* Acquire(UClass* ActorClass, const FTransform& Transform, const FActorSpawnParameters& SpawnParameters = FActorSpawnParameters());
+
+	/** Typed version of Acquire. */
+	template <class T>
+	T* Acquire(UClass* ActorClass, const FTransform& Transform, const FActorSpawnParameters& SpawnParameters = FActorSpawnParameters())
+	{
+		return Cast<T>(Acquire(ActorClass, Transform, SpawnParameters));
+	}
+
+	/** Takes an actor of the given class from the pool, or spawns one if the pool is empty. */
+	UFUNCTION(BlueprintCallable, Category = "Pooling", meta = (DeterminesOutputType = "ActorClass"))
+	AActor* AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform);
+
+	/** Deactivates the given actor and parks it in the pool for reuse. Releasing an actor that is already parked does nothing. */
+	UFUNCTION(BlueprintCallable, Category = "Pooling")
+	void ReleaseActor(AActor* Actor);
+
+	/** Spawns parked actors until the pool for the given class holds at least the given count. */
+	UFUNCTION(BlueprintCallable, Category = "Pooling")
+	void Prewarm(TSubclassOf<AActor> ActorClass, int32 Count);
+
+	/** Returns the number of parked actors of the given class. */
+	UFUNCTION(BlueprintPure, Category = "Pooling")
+	int32 GetFreeCount(TSubclassOf<AActor> ActorClass) const;
+
+	/** Returns how many acquisitions of the given class were served from and missed the pool. */
+	UFUNCTION(BlueprintPure, Category = "Pooling")
+	void GetPoolStats(TSubclassOf<AActor> ActorClass, int32& OutHits, int32& OutMisses) const;
+
+	/** Returns how many acquisitions of every class were served from and missed the pool. */
+	UFUNCTION(BlueprintPure, Category = "Pooling")
+	void GetTotalPoolStats(int32& OutHits, int32& OutMisses) const;
+
+private:
+
+	/** Deactivates the actor and adds it to the given bucket's parked actors. */
+	void ParkActor(FActorPoolBucket& Bucket, AActor* Actor);
+
+	/** Hides the actor and stops it from colliding and ticking. Returns the state to restore on activation. */
+	static FParkedActor DeactivateActor(AActor* Actor);
+
+	/** Restores the visibility and collision the actor was parked with, and its default ticking. */
+	static void ActivateActor(AActor* Actor, const FParkedActor& Parked);
+
+	/**
+	 * Applies the spawn collision handling method to a reused actor, moving
+	 * the transform out of blocking geometry where allowed.
+	 *
+	 * @return False if the method forbids placing the actor at the transform.
+	 */
+	static bool AdjustForCollision(AActor* Actor, const FActorSpawnParameters& SpawnParameters, FTransform& InOutTransform);
+
+	/** Pools indexed by exact actor class. */
+	TMap<TObjectKey<UClass>, FActorPoolBucket> Buckets;
+
+	/** Every actor parked in any bucket, to catch actors released twice. */
+	TSet<TWeakObjectPtr<AActor>> ParkedActors;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "PooledActorInterface.generated.h"
+
+UINTERFACE(MinimalAPI, BlueprintType)
+class UPooledActor : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Reset hooks for actors recycled through UActorPoolSubsystem. Pooled actors
+ * are hidden and stop colliding and ticking on their own; these hooks reset
+ * whatever gameplay state they carry.
+ */
+class DESCENTCORE_API IPooledActor
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Invoked after the actor is taken from the pool and moved into place. */
+	UFUNCTION(BlueprintNativeEvent, Category = "Pooling")
+	void OnAcquiredFromPool();
+
+	/** Invoked before the actor is parked in the pool. Should return the actor to its spawned state. */
+	UFUNCTION(BlueprintNativeEvent, Category = "Pooling")
+	void OnReturnedToPool();
+};